@@ -0,0 +1,439 @@
+/**
+ * @file main.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Headless trainer and batch inference for the eig_neuron networks
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dataset.hh>
+#include <NN.hh>
+#include <shuffle.hh>
+#include <checkpoint.hh>
+#include <trainer.hh>
+#include <validation.hh>
+
+/**
+ * @brief Options of the command line.
+ */
+struct Options
+{
+  std::string      command;                                      /**< train or predict. */
+  std::string      data;                                         /**< CSV file with a header line. */
+  std::string      model;                                        /**< Model written by train, read by predict. */
+  std::string      init;                                         /**< Model to start training from. */
+  std::string      predictions;                                  /**< CSV file receiving the predictions. */
+  std::string      checkpoint;                                   /**< Path and name prefix of the checkpoints, empty to disable. */
+  std::vector<int> topology           = {7, 16, 1};              /**< Topology of a new network. */
+  ActivationType   hidden             = ActivationType::Sigmoid; /**< Activation of the hidden layers. */
+  ActivationType   output             = ActivationType::Sigmoid; /**< Activation of the output layer. */
+  OptimizerType    optimizer          = OptimizerType::SGD;      /**< Optimizer. */
+  double           learning_rate      = 0.25;                    /**< Learning rate. */
+  double           momentum           = 0.15;                    /**< Momentum. */
+  double           threshold          = 0.5;                     /**< Threshold of the accuracy. */
+  int              epochs             = 20;                      /**< Number of epochs. */
+  int              batch_size         = 32;                      /**< Samples per batch. */
+  int              threads            = 1;                       /**< Training or scoring threads. */
+  int              id_columns         = 1;                       /**< Columns before the features. */
+  unsigned         seed               = 0;                       /**< Seed of the shuffling, 0 for a random one. */
+  int              checkpoint_epochs  = 1;                       /**< Checkpoint every this many epochs, 0 to disable. */
+  double           checkpoint_seconds = 0;                       /**< Checkpoint every this many seconds, 0 to disable. */
+  int              keep               = CHECKPOINT_KEEP;         /**< Number of checkpoints kept. */
+  int              validation         = 0;                       /**< Percentage of the samples held out for validation. */
+  int              patience           = VALIDATION_PATIENCE;     /**< Epochs without validation improvement before stopping. */
+  double           target_accuracy    = 0;                       /**< Validation accuracy at which to stop. */
+  bool             shuffle            = true;                    /**< Train in a new random order every epoch. */
+  bool             single             = false;                   /**< Compute in single precision. */
+};
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Seconds elapsed since a time point.
+ * @param start Time point.
+ * @return Elapsed seconds.
+ */
+static double secondsSince(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+/**
+ * @brief Print the usage.
+ * @param program Name of the executable.
+ */
+static void usage(const char *program)
+{
+  std::cerr << "usage: " << program << " train --data FILE --model FILE [options]\n"
+            << "       " << program << " predict --data FILE --model FILE [--predictions FILE] [options]\n"
+            << "\n"
+            << "  --topology 7,16,1      layer sizes of a new network, inputs first\n"
+            << "  --init FILE            start training from a saved model\n"
+            << "  --hidden NAME          hidden activation: sigmoid, relu, tanh, leakyrelu\n"
+            << "  --output NAME          output activation: sigmoid, relu, tanh, leakyrelu, softmax\n"
+            << "  --optimizer NAME       sgd, nesterov, rmsprop or adam\n"
+            << "  --lr VALUE             learning rate (0.25)\n"
+            << "  --momentum VALUE       momentum (0.15)\n"
+            << "  --epochs N             training epochs (20)\n"
+            << "  --batch N              samples per batch (32)\n"
+            << "  --threads N            training or scoring threads, 0 for all cores (1)\n"
+            << "  --threshold VALUE      output threshold of the accuracy (0.5)\n"
+            << "  --id-columns N         columns before the features (1)\n"
+            << "  --checkpoint PREFIX    write checkpoints PREFIX-EPOCH.model while training\n"
+            << "  --checkpoint-every N   checkpoint every N epochs, 0 to disable (1)\n"
+            << "  --checkpoint-seconds T checkpoint every T seconds, 0 to disable (0)\n"
+            << "  --keep N               checkpoints kept (" << CHECKPOINT_KEEP << ")\n"
+            << "  --validation PERCENT   hold out the last samples for validation and keep the best epoch (0)\n"
+            << "  --patience N           stop after N epochs without validation improvement, 0 to disable (" << VALIDATION_PATIENCE << ")\n"
+            << "  --target-accuracy PCT  stop once the validation accuracy reaches PCT, 0 to disable (0)\n"
+            << "  --no-shuffle           train in file order instead of a new random order every epoch\n"
+            << "  --seed N               seed of the shuffling, 0 for a random one (0)\n"
+            << "  --float                compute in single precision\n";
+}
+
+/**
+ * @brief Parse an activation name.
+ * @param name Name, case sensitive.
+ * @param type Parsed activation.
+ * @return True if the name is known.
+ */
+static bool parseActivation(const std::string &name, ActivationType &type)
+{
+  static const std::map<std::string, ActivationType> names = {
+    {"sigmoid",   ActivationType::Sigmoid  },
+    {"relu",      ActivationType::ReLU     },
+    {"tanh",      ActivationType::Tanh     },
+    {"leakyrelu", ActivationType::LeakyReLU},
+    {"softmax",   ActivationType::Softmax  },
+  };
+  auto found = names.find(name);
+  if(found == names.end()) return false;
+  type = found->second;
+  return true;
+}
+
+/**
+ * @brief Parse an optimizer name.
+ * @param name Name, case sensitive.
+ * @param type Parsed optimizer.
+ * @return True if the name is known.
+ */
+static bool parseOptimizer(const std::string &name, OptimizerType &type)
+{
+  static const std::map<std::string, OptimizerType> names = {
+    {"sgd",      OptimizerType::SGD     },
+    {"nesterov", OptimizerType::Nesterov},
+    {"rmsprop",  OptimizerType::RMSProp },
+    {"adam",     OptimizerType::Adam    },
+  };
+  auto found = names.find(name);
+  if(found == names.end()) return false;
+  type = found->second;
+  return true;
+}
+
+/**
+ * @brief Parse a comma separated topology.
+ * @param text Layer sizes, e.g. 7,16,1.
+ * @param topology Parsed topology.
+ * @return True if there are at least two positive sizes.
+ */
+static bool parseTopology(const std::string &text, std::vector<int> &topology)
+{
+  std::stringstream ss(text);
+  std::string       size;
+  topology.clear();
+  while(getline(ss, size, ','))
+    {
+      int value = std::atoi(size.c_str());
+      if(value <= 0) return false;
+      topology.push_back(value);
+    }
+  return topology.size() >= 2;
+}
+
+/**
+ * @brief Parse the command line.
+ * @param argc Number of arguments.
+ * @param argv Arguments.
+ * @param options Parsed options.
+ * @return True if the command line is valid.
+ */
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+  if(argc < 2) return false;
+  options.command = argv[1];
+  if(options.command != "train" && options.command != "predict") return false;
+
+  for(int i = 2; i < argc; ++i)
+    {
+      std::string flag = argv[i];
+      if(flag == "--float")
+        {
+          options.single = true;
+          continue;
+        }
+      if(flag == "--no-shuffle")
+        {
+          options.shuffle = false;
+          continue;
+        }
+      if(i + 1 >= argc)
+        {
+          std::cerr << "Missing value for " << flag << std::endl;
+          return false;
+        }
+      std::string value = argv[++i];
+      bool        valid = true;
+      if(flag == "--data") options.data = value;
+      else if(flag == "--model") options.model = value;
+      else if(flag == "--init") options.init = value;
+      else if(flag == "--predictions") options.predictions = value;
+      else if(flag == "--topology") valid = parseTopology(value, options.topology);
+      else if(flag == "--hidden") valid = parseActivation(value, options.hidden) && options.hidden != ActivationType::Softmax;
+      else if(flag == "--output") valid = parseActivation(value, options.output);
+      else if(flag == "--optimizer") valid = parseOptimizer(value, options.optimizer);
+      else if(flag == "--lr") options.learning_rate = std::atof(value.c_str());
+      else if(flag == "--momentum") options.momentum = std::atof(value.c_str());
+      else if(flag == "--threshold") options.threshold = std::atof(value.c_str());
+      else if(flag == "--epochs") valid = (options.epochs = std::atoi(value.c_str())) > 0;
+      else if(flag == "--batch") valid = (options.batch_size = std::atoi(value.c_str())) > 0;
+      else if(flag == "--threads") valid = (options.threads = std::atoi(value.c_str())) >= 0;
+      else if(flag == "--id-columns") valid = (options.id_columns = std::atoi(value.c_str())) >= 0;
+      else if(flag == "--checkpoint") options.checkpoint = value;
+      else if(flag == "--checkpoint-every") valid = (options.checkpoint_epochs = std::atoi(value.c_str())) >= 0;
+      else if(flag == "--checkpoint-seconds") valid = (options.checkpoint_seconds = std::atof(value.c_str())) >= 0;
+      else if(flag == "--seed") options.seed = std::strtoul(value.c_str(), nullptr, 10);
+      else if(flag == "--keep") valid = (options.keep = std::atoi(value.c_str())) > 0;
+      else if(flag == "--validation") valid = (options.validation = std::atoi(value.c_str())) >= 0 && options.validation < 100;
+      else if(flag == "--patience") valid = (options.patience = std::atoi(value.c_str())) >= 0;
+      else if(flag == "--target-accuracy") valid = (options.target_accuracy = std::atof(value.c_str())) >= 0;
+      else
+        {
+          std::cerr << "Unknown option " << flag << std::endl;
+          return false;
+        }
+      if(!valid)
+        {
+          std::cerr << "Invalid value for " << flag << ": " << value << std::endl;
+          return false;
+        }
+    }
+
+  if(options.data.empty() || options.model.empty())
+    {
+      std::cerr << "Both --data and --model are required" << std::endl;
+      return false;
+    }
+  if(options.threads == 0) options.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+  return true;
+}
+
+/**
+ * @brief Error and accuracy of a set of outputs.
+ * @param outputs Outputs, one column per sample.
+ * @param targets Targets, one column per sample.
+ * @param threshold Output threshold, a sample is correct when every thresholded output matches its target.
+ * @param error Mean over the samples of the squared error.
+ * @param accuracy Percentage of correct samples.
+ */
+template <typename Matrix> static void score(const Ref<const Matrix> &outputs, const Ref<const Matrix> &targets, double threshold, double &error, double &accuracy)
+{
+  typedef typename Matrix::Scalar Scalar;
+  error        = double((outputs - targets).squaredNorm()) / outputs.cols();
+  auto correct = (((outputs.array() >= Scalar(threshold)).template cast<Scalar>() - targets.array()).abs() < Scalar(0.5)).colwise().all();
+  accuracy     = 100.0 * correct.count() / outputs.cols();
+}
+
+/**
+ * @brief Load the dataset and wait for it.
+ * @param options Options.
+ * @param dataset Dataset, sized by the caller.
+ * @return True if the whole file was parsed.
+ */
+template <typename Scalar> static bool loadDataset(const Options &options, BasicCsvDataset<Scalar> &dataset)
+{
+  auto start = Clock::now();
+  if(!dataset.open(options.data) || !dataset.wait()) return false;
+  double seconds = secondsSince(start);
+  std::cout << "loaded " << dataset.rowsReady() << " samples from " << options.data << " in " << seconds << " s (" << dataset.rowsReady() / seconds << " samples/s)" << std::endl;
+  return dataset.rowsReady() > 0;
+}
+
+/**
+ * @brief Train a network and save it.
+ * @param options Options.
+ * @return Exit code.
+ */
+template <typename Scalar> static int train(const Options &options)
+{
+  std::vector<ActivationType> activations(options.topology.size() - 1, options.hidden);
+  activations.back() = options.output;
+  BasicNeuralNetwork<Scalar> network(options.topology, options.learning_rate, options.momentum, activations);
+  if(!options.init.empty() && !network.loadWeights(options.init)) return EXIT_FAILURE;
+  network.setOptimizer(options.optimizer);
+
+  std::vector<int>        topology = network.getTopology();
+  BasicCsvDataset<Scalar> dataset(topology.front(), topology.back(), options.id_columns);
+  if(!loadDataset(options, dataset)) return EXIT_FAILURE;
+
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  const Matrix                                       &features     = dataset.getFeatures();
+  const Matrix                                       &targets      = dataset.getTargets();
+  int                                                 held_out     = dataset.rowsReady() * options.validation / 100;
+  int                                                 samples      = dataset.rowsReady() - held_out;
+  int                                                 epochs       = 0;
+  bool                                                publishing   = !options.checkpoint.empty() || held_out > 0;
+  bool                                                checkpointed = false;
+  Matrix                                              outputs(targets.rows(), samples);
+  BasicParallelTrainer<Scalar>                        trainer(network, options.threads);
+  BasicWeightPublisher<Scalar>                        snapshots;
+  BasicCheckpointer<Scalar>                           checkpointer(options.checkpoint, options.keep, options.checkpoint_epochs, options.checkpoint_seconds);
+  BasicValidator<Scalar>                              validator(options.threads, options.threshold, options.patience, options.target_accuracy);
+  BasicBatchShuffler<Scalar>                          shuffler(options.seed != 0 ? options.seed : std::random_device{}());
+  trainer.reserveBatch(options.batch_size);
+
+  std::cout << "training " << (options.single ? "float" : "double") << " network, " << optimizerName(options.optimizer) << ", " << options.threads << " threads, batch " << options.batch_size << std::endl;
+  if(held_out > 0) std::cout << "holding out the last " << held_out << " samples for validation" << std::endl;
+  auto   start = Clock::now();
+  double error = 0, accuracy = 0;
+  while(epochs < options.epochs)
+    {
+      auto epoch_start = Clock::now();
+      if(options.shuffle) shuffler.shuffle(samples);
+      for(int batch_start = 0; batch_start < samples; batch_start += options.batch_size)
+        {
+          int batch_count = std::min(options.batch_size, samples - batch_start);
+          if(options.shuffle)
+            {
+              shuffler.gather(features, targets, batch_start, batch_count);
+              trainer.trainBatch(shuffler.getInputs(), shuffler.getTargets());
+              shuffler.scatter(trainer.getResults(), outputs);
+              continue;
+            }
+          trainer.trainBatch(features.middleCols(batch_start, batch_count), targets.middleCols(batch_start, batch_count));
+          outputs.middleCols(batch_start, batch_count) = trainer.getResults();
+        }
+      double seconds = secondsSince(epoch_start);
+      score<Matrix>(outputs, targets.leftCols(samples), options.threshold, error, accuracy);
+      std::printf("epoch %4d  error %.6f  accuracy %6.2f%%  %8.3f ms  %12.0f samples/s\n", epochs, error, accuracy, seconds * 1e3, samples / seconds);
+      ++epochs;
+      // only the copy into the snapshot is paid here, files and validation run in background
+      if(publishing) snapshots.publish(network);
+      if(!options.checkpoint.empty()) checkpointed = checkpointer.epochEnded(snapshots.latest(), epochs);
+      if(held_out > 0)
+        {
+          // the previous epoch was scored while this one trained, there is none after the first epoch
+          bool stop = validator.finish();
+          if(validator.getLast().epoch > 0 && validator.getLast().epoch == epochs - 1) std::printf("  validation of epoch %4d  error %.6f  accuracy %6.2f%%\n", epochs - 2, validator.getLast().error, validator.getLast().accuracy);
+          if(stop) break;
+          validator.start(snapshots.latest(), features.middleCols(samples, held_out), targets.middleCols(samples, held_out), epochs);
+        }
+    }
+  double seconds = secondsSince(start);
+  std::printf("trained %d epochs in %.3f s, %.0f samples/s\n", epochs, seconds, double(samples) * epochs / seconds);
+
+  if(held_out > 0)
+    {
+      validator.finish();
+      const ValidationResult &best = validator.getBest();
+      // epochs are numbered from 0 in the log, a result counts completed epochs
+      if(validator.shouldStop()) std::printf("stopped early, validation error %.6f accuracy %.2f%% at epoch %d\n", validator.getLast().error, validator.getLast().accuracy, validator.getLast().epoch - 1);
+      std::printf("restoring epoch %d, validation error %.6f accuracy %.2f%%\n", best.epoch - 1, best.error, best.accuracy);
+      network.copyParameters(*validator.getBestSnapshot());
+      snapshots.publish(network);
+      checkpointed = false;
+    }
+  if(!options.checkpoint.empty())
+    {
+      if(!checkpointed) checkpointer.submit(snapshots.latest(), held_out > 0 ? validator.getBest().epoch : epochs);
+      checkpointer.flush();
+      std::cout << "last checkpoint " << checkpointer.getLastPath() << std::endl;
+    }
+
+  if(!network.saveWeights(options.model)) return EXIT_FAILURE;
+  std::cout << "model saved to " << options.model << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Score a dataset with a saved network.
+ * @param options Options.
+ * @return Exit code.
+ */
+template <typename Scalar> static int predict(const Options &options)
+{
+  BasicNeuralNetwork<Scalar> network(options.topology, options.learning_rate, options.momentum);
+  if(!network.loadWeights(options.model)) return EXIT_FAILURE;
+
+  std::vector<int>        topology = network.getTopology();
+  BasicCsvDataset<Scalar> dataset(topology.front(), topology.back(), options.id_columns);
+  if(!loadDataset(options, dataset)) return EXIT_FAILURE;
+
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  const Matrix                                       &features = dataset.getFeatures();
+  const Matrix                                       &targets  = dataset.getTargets();
+  int                                                 samples  = dataset.rowsReady();
+  Matrix                                              outputs(targets.rows(), samples);
+  std::vector<std::thread>                            workers;
+
+  // the network is only read, every thread scores its own range of columns
+  auto start = Clock::now();
+  int  slice = (samples + options.threads - 1) / options.threads;
+  for(int first = slice; first < samples; first += slice)
+    {
+      int count = std::min(slice, samples - first);
+      workers.emplace_back([&, first, count] { network.predict(features.middleCols(first, count), outputs.middleCols(first, count)); });
+    }
+  network.predict(features.leftCols(std::min(slice, samples)), outputs.leftCols(std::min(slice, samples)));
+  for(auto &worker : workers) worker.join();
+  double seconds = secondsSince(start);
+
+  double error, accuracy;
+  score<Matrix>(outputs, targets.leftCols(samples), options.threshold, error, accuracy);
+  std::printf("scored %d samples on %d threads in %.3f ms, %.0f samples/s\n", samples, options.threads, seconds * 1e3, samples / seconds);
+  std::printf("error %.6f  accuracy %.2f%%\n", error, accuracy);
+
+  if(!options.predictions.empty())
+    {
+      std::ofstream file(options.predictions);
+      if(!file.is_open())
+        {
+          std::cerr << "Error opening file: " << options.predictions << std::endl;
+          return EXIT_FAILURE;
+        }
+      const std::vector<int> &ids = dataset.getIds();
+      for(int i = 0; i < samples; ++i)
+        {
+          file << ids[i];
+          for(int o = 0; o < outputs.rows(); ++o) file << COLUMN_SEPARATOR << outputs(o, i);
+          file << ROW_SEPARATOR;
+        }
+      std::cout << "predictions saved to " << options.predictions << std::endl;
+    }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!parseOptions(argc, argv, options))
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if(options.command == "train") return options.single ? train<float>(options) : train<double>(options);
+  return options.single ? predict<float>(options) : predict<double>(options);
+}
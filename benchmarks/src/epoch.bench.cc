@@ -0,0 +1,103 @@
+/**
+ * @file epoch.bench.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief End-to-end training epoch on the apple quality dataset
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <dataset.hh>
+#include <NN.hh>
+#include <shuffle.hh>
+#include <trainer.hh>
+
+/**
+ * @brief Load the dataset and wait for it.
+ * @param state Benchmark state, marked as failed if the file can not be read.
+ * @param dataset Dataset to fill.
+ * @return True if the whole file was parsed.
+ */
+template <typename Scalar> static bool loadApples(benchmark::State &state, BasicCsvDataset<Scalar> &dataset)
+{
+  if(dataset.open(RES_DIR "/apple_qlty.csv") && dataset.wait() && dataset.rowsReady() > 0) return true;
+  state.SkipWithError("unable to load " RES_DIR "/apple_qlty.csv");
+  return false;
+}
+
+/**
+ * @brief Streaming load of the CSV file.
+ */
+template <typename Scalar> static void BM_LoadDataset(benchmark::State &state)
+{
+  BasicCsvDataset<Scalar> dataset(7, 1);
+  for(auto _ : state)
+    {
+      if(!loadApples(state, dataset)) return;
+    }
+  state.SetItemsProcessed(state.iterations() * dataset.rowsReady());
+}
+BENCHMARK_TEMPLATE(BM_LoadDataset, double)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * @brief One epoch of the GUI defaults, batches of 32, the argument is the number of threads.
+ */
+template <typename Scalar> static void BM_Epoch(benchmark::State &state)
+{
+  BasicCsvDataset<Scalar> dataset(7, 1);
+  if(!loadApples(state, dataset)) return;
+
+  BasicNeuralNetwork<Scalar>   network({7, 16, 1}, 0.25, 0.15);
+  BasicParallelTrainer<Scalar> trainer(network, state.range(0));
+  const int                    batch_size = 32;
+  int                          samples    = dataset.rowsReady();
+  trainer.reserveBatch(batch_size);
+
+  for(auto _ : state)
+    {
+      for(int batch_start = 0; batch_start < samples; batch_start += batch_size)
+        {
+          int batch_count = std::min(batch_size, samples - batch_start);
+          trainer.trainBatch(dataset.getFeatures().middleCols(batch_start, batch_count), dataset.getTargets().middleCols(batch_start, batch_count));
+        }
+    }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK_TEMPLATE(BM_Epoch, double)->RangeMultiplier(2)->Range(1, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Epoch, float)->RangeMultiplier(2)->Range(1, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * @brief One shuffled epoch, batches gathered through the permutation, the argument is the number of threads.
+ */
+template <typename Scalar> static void BM_ShuffledEpoch(benchmark::State &state)
+{
+  BasicCsvDataset<Scalar> dataset(7, 1);
+  if(!loadApples(state, dataset)) return;
+
+  BasicNeuralNetwork<Scalar>                  network({7, 16, 1}, 0.25, 0.15);
+  BasicParallelTrainer<Scalar>                trainer(network, state.range(0));
+  BasicBatchShuffler<Scalar>                  shuffler(42);
+  typename BasicNeuralNetwork<Scalar>::Matrix outputs(1, dataset.rowsReady());
+  const int                                   batch_size = 32;
+  int                                         samples    = dataset.rowsReady();
+  trainer.reserveBatch(batch_size);
+
+  for(auto _ : state)
+    {
+      shuffler.shuffle(samples);
+      for(int batch_start = 0; batch_start < samples; batch_start += batch_size)
+        {
+          int batch_count = std::min(batch_size, samples - batch_start);
+          shuffler.gather(dataset.getFeatures(), dataset.getTargets(), batch_start, batch_count);
+          trainer.trainBatch(shuffler.getInputs(), shuffler.getTargets());
+          shuffler.scatter(trainer.getResults(), outputs);
+        }
+    }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK_TEMPLATE(BM_ShuffledEpoch, double)->RangeMultiplier(2)->Range(1, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShuffledEpoch, float)->RangeMultiplier(2)->Range(1, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
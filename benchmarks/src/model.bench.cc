@@ -0,0 +1,86 @@
+/**
+ * @file model.bench.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Model file save and load benchmarks
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <NN.hh>
+
+/**
+ * @brief Path of the scratch model file.
+ * @return A file in the temporary directory.
+ */
+static std::string modelPath() { return (std::filesystem::temp_directory_path() / "eig_neuron_bench.model").string(); }
+
+/**
+ * @brief Topology of a model with two hidden layers of a given width.
+ * @param hidden Width of the hidden layers.
+ * @return Topology.
+ */
+static std::vector<int> modelTopology(int hidden) { return {64, hidden, hidden, 10}; }
+
+/**
+ * @brief Number of bytes of weights and biases of a topology.
+ * @param topology Topology.
+ * @param scalar_size Size of a scalar.
+ * @return Number of bytes.
+ */
+static int64_t modelBytes(const std::vector<int> &topology, size_t scalar_size)
+{
+  int64_t parameters = 0;
+  for(size_t i = 0; i + 1 < topology.size(); ++i) parameters += int64_t(topology[i + 1]) * (topology[i] + 1);
+  return parameters * scalar_size;
+}
+
+/**
+ * @brief saveWeights time, the argument is the hidden layer width.
+ */
+template <typename Scalar> static void BM_SaveWeights(benchmark::State &state)
+{
+  std::vector<int>           topology = modelTopology(state.range(0));
+  BasicNeuralNetwork<Scalar> network(topology, 0.1, 0.0);
+  std::string                path = modelPath();
+
+  for(auto _ : state)
+    {
+      if(!network.saveWeights(path)) state.SkipWithError("saveWeights failed");
+    }
+  state.SetBytesProcessed(state.iterations() * modelBytes(topology, sizeof(Scalar)));
+  std::remove(path.c_str());
+}
+BENCHMARK_TEMPLATE(BM_SaveWeights, double)->RangeMultiplier(4)->Range(16, 1024)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SaveWeights, float)->RangeMultiplier(4)->Range(16, 1024)->UseRealTime();
+
+/**
+ * @brief loadWeights time, the argument is the hidden layer width.
+ */
+template <typename Scalar> static void BM_LoadWeights(benchmark::State &state)
+{
+  std::vector<int>           topology = modelTopology(state.range(0));
+  BasicNeuralNetwork<Scalar> network(topology, 0.1, 0.0);
+  std::string                path = modelPath();
+  if(!network.saveWeights(path))
+    {
+      state.SkipWithError("saveWeights failed");
+      return;
+    }
+
+  for(auto _ : state)
+    {
+      if(!network.loadWeights(path)) state.SkipWithError("loadWeights failed");
+    }
+  state.SetBytesProcessed(state.iterations() * modelBytes(topology, sizeof(Scalar)));
+  std::remove(path.c_str());
+}
+BENCHMARK_TEMPLATE(BM_LoadWeights, double)->RangeMultiplier(4)->Range(16, 1024)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LoadWeights, float)->RangeMultiplier(4)->Range(16, 1024)->UseRealTime();
@@ -0,0 +1,108 @@
+/**
+ * @file network.bench.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Forward, backpropagation and trainer scaling benchmarks
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <NN.hh>
+#include <trainer.hh>
+
+/**
+ * @brief Topologies measured by the forward benchmark, from the apple model to a wide network.
+ */
+static const std::vector<std::vector<int>> topologies = {
+  {7, 16, 1},
+  {64, 128, 10},
+  {256, 512, 512, 10},
+};
+
+/**
+ * @brief Topology of the backpropagation and trainer benchmarks.
+ */
+static const std::vector<int> training_topology = {64, 256, 256, 10};
+
+/**
+ * @brief Forward pass latency, arguments are the topology index and the batch size.
+ */
+template <typename Scalar> static void BM_Forward(benchmark::State &state)
+{
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  const std::vector<int>                             &topology = topologies[state.range(0)];
+  int                                                 batch    = state.range(1);
+  BasicNeuralNetwork<Scalar>                          network(topology, 0.1, 0.0);
+  Matrix                                              inputs = Matrix::Random(topology.front(), batch);
+  network.reserveBatch(batch);
+
+  for(auto _ : state)
+    {
+      network.forwardPropagation(inputs);
+      benchmark::DoNotOptimize(network.getResults().data());
+    }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_TEMPLATE(BM_Forward, double)->ArgsProduct({{0, 1, 2}, {1, 32, 256}});
+BENCHMARK_TEMPLATE(BM_Forward, float)->ArgsProduct({{0, 1, 2}, {1, 32, 256}});
+
+/**
+ * @brief Forward and backward pass with one update, the argument is the batch size.
+ */
+template <typename Scalar> static void BM_Backprop(benchmark::State &state)
+{
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  int                                                 batch = state.range(0);
+  BasicNeuralNetwork<Scalar>                          network(training_topology, 0.01, 0.9);
+  Matrix                                              inputs  = Matrix::Random(training_topology.front(), batch);
+  Matrix                                              targets = (Matrix::Random(training_topology.back(), batch).array() + 1) / 2;
+  network.reserveBatch(batch);
+
+  for(auto _ : state)
+    {
+      network.forwardPropagation(inputs);
+      network.backpropagation(targets);
+    }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_TEMPLATE(BM_Backprop, double)->RangeMultiplier(4)->Range(1, 1024);
+BENCHMARK_TEMPLATE(BM_Backprop, float)->RangeMultiplier(4)->Range(1, 1024);
+
+/**
+ * @brief Parallel trainer on a batch of 256 samples, the argument is the number of threads.
+ */
+template <typename Scalar> static void BM_TrainerThreads(benchmark::State &state)
+{
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  const int                                           batch = 256;
+  BasicNeuralNetwork<Scalar>                          network(training_topology, 0.01, 0.9);
+  BasicParallelTrainer<Scalar>                        trainer(network, state.range(0));
+  Matrix                                              inputs  = Matrix::Random(training_topology.front(), batch);
+  Matrix                                              targets = (Matrix::Random(training_topology.back(), batch).array() + 1) / 2;
+  trainer.reserveBatch(batch);
+
+  for(auto _ : state) { trainer.trainBatch(inputs, targets); }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_TEMPLATE(BM_TrainerThreads, double)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TrainerThreads, float)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+/**
+ * @brief Concurrent predict() on one shared network, batches of 32 on every benchmark thread.
+ */
+template <typename Scalar> static void BM_PredictThreads(benchmark::State &state)
+{
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  static const BasicNeuralNetwork<Scalar>             network(training_topology, 0.1, 0.0);
+  const int                                           batch  = 32;
+  Matrix                                              inputs = Matrix::Random(training_topology.front(), batch);
+
+  for(auto _ : state) { benchmark::DoNotOptimize(network.predict(inputs).data()); }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_TEMPLATE(BM_PredictThreads, double)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PredictThreads, float)->ThreadRange(1, 16)->UseRealTime();
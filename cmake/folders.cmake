@@ -2,4 +2,6 @@
 set_property(GLOBAL PROPERTY ROOTDIR ${PROJECT_SOURCE_DIR})
 set_property(GLOBAL PROPERTY LIBDIR ${PROJECT_SOURCE_DIR}/lib)
 set_property(GLOBAL PROPERTY RESDIR ${PROJECT_SOURCE_DIR}/resources)
-set_property(GLOBAL PROPERTY APPDIR ${PROJECT_SOURCE_DIR}/app)
\ No newline at end of file
+set_property(GLOBAL PROPERTY APPDIR ${PROJECT_SOURCE_DIR}/app)
+set_property(GLOBAL PROPERTY BENCHDIR ${PROJECT_SOURCE_DIR}/benchmarks)
+set_property(GLOBAL PROPERTY TESTDIR ${PROJECT_SOURCE_DIR}/tests)
\ No newline at end of file
@@ -9,3 +9,8 @@ get_property(APPS_DIR GLOBAL PROPERTY APPDIR)
 
 # libs
 get_property(LIB_DIR GLOBAL PROPERTY LIBDIR)
+
+# benchmarks
+get_property(BENCH_DIR GLOBAL PROPERTY BENCHDIR)
+# tests
+get_property(TEST_DIR GLOBAL PROPERTY TESTDIR)
@@ -2,4 +2,13 @@ include(cmake/init.cmake)
 add_subdirectory(${LIB_DIR}/wxLayout)
 add_subdirectory(${LIB_DIR}/nn_eigen)
 add_subdirectory(${LIB_DIR}/lstm)
-
+add_subdirectory(${APPS_DIR})
+option(BUILD_BENCHMARKS "Build the Google Benchmark suite" ON)
+if(BUILD_BENCHMARKS)
+    add_subdirectory(${BENCH_DIR})
+endif()
+option(BUILD_TESTS "Build the ctest suite" ON)
+if(BUILD_TESTS)
+    enable_testing()
+    add_subdirectory(${TEST_DIR})
+endif()
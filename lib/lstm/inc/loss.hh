@@ -0,0 +1,95 @@
+/**
+ * @file loss.hh
+ * @author andres coronado (invizuz@gmail.com)
+ * @brief Loss functions of the LSTM, selected at runtime
+ * @version 0.1
+ * @date 2024-03-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef LSTM_LOSS_H
+#define LSTM_LOSS_H
+
+#include <Eigen/Dense>
+
+/**
+ * @brief Default threshold between the quadratic and the linear part of the Huber loss.
+ */
+#define LOSS_HUBER_DELTA 1.0
+
+/**
+ * @brief Loss functions of the LSTM.
+ */
+enum class LossType
+{
+  MSE,                     /**< Half the squared error of linear outputs. */
+  BinaryCrossEntropy,      /**< Cross entropy of a sigmoid over every output, targets in [0, 1]. */
+  CategoricalCrossEntropy, /**< Cross entropy of a softmax over every column, targets sum to 1 per column. */
+  Hinge,                   /**< Margin loss of linear outputs, targets in {-1, 1}. */
+  Huber,                   /**< Squared error near the target, absolute error beyond the threshold. */
+};
+
+/**
+ * @brief Loss function of the LSTM outputs, with its value and its gradient.
+ *
+ * The network outputs are the raw readout: the cross entropies take them as
+ * logits and apply the sigmoid or the softmax themselves, in forms that never
+ * take the logarithm of a rounded probability. predict() turns outputs into
+ * the predictions the loss compares with the targets.
+ *
+ * Every column is one sample: value() is the mean over the columns of the
+ * per-sample loss, gradient() the gradient of the per-sample loss, which the
+ * caller averages.
+ */
+class Loss
+{
+  public:
+  /**
+   * @brief Constructor.
+   * @param type Loss function.
+   * @param huber_delta Threshold of the Huber loss, ignored by the others.
+   */
+  Loss(LossType type = LossType::MSE, double huber_delta = LOSS_HUBER_DELTA) : type_(type), huber_delta_(huber_delta) {}
+
+  /**
+   * @brief Compute the loss.
+   * @param outputs Network outputs, one column per sample.
+   * @param targets Expected outputs, one column per sample.
+   * @return Mean loss per column.
+   */
+  double value(const Eigen::MatrixXd &outputs, const Eigen::MatrixXd &targets) const;
+
+  /**
+   * @brief Compute the gradient of the loss of every column with respect to the outputs.
+   * @param outputs Network outputs, one column per sample.
+   * @param targets Expected outputs, one column per sample.
+   * @param gradient Gradient, resized to the outputs.
+   */
+  void gradient(const Eigen::MatrixXd &outputs, const Eigen::MatrixXd &targets, Eigen::MatrixXd &gradient) const;
+
+  /**
+   * @brief Map network outputs to predictions.
+   * @param outputs Network outputs, one column per sample.
+   * @return Probabilities for the cross entropies, the outputs otherwise.
+   */
+  Eigen::MatrixXd predict(const Eigen::MatrixXd &outputs) const;
+
+  /**
+   * @brief Get the loss function.
+   * @return Loss type.
+   */
+  LossType get_type() const { return type_; }
+
+  /**
+   * @brief Get the display name of the loss function.
+   * @return Name of the loss.
+   */
+  const char *get_name() const;
+
+  private:
+  LossType type_;        /**< Loss function. */
+  double   huber_delta_; /**< Threshold of the Huber loss. */
+};
+
+#endif // LSTM_LOSS_H
@@ -1,7 +1,7 @@
 /**
  * @file lstm.hh
  * @author andres coronado (invizuz@gmail.com)
- * @brief
+ * @brief Stacked LSTM trained with truncated backpropagation through time
  * @version 0.1
  * @date 2024-03-21
  *
@@ -11,47 +11,249 @@
 #ifndef LSTM_H
 #define LSTM_H
 
-#include <Eigen/Dense>
+#include <algorithm>
 #include <vector>
+#include <Eigen/Dense>
+#include "loss.hh"
+
+/**
+ * @brief Default number of timesteps backpropagated by train().
+ */
+#define LSTM_BPTT_WINDOW 32
+
+/**
+ * @brief Tape columns forward() and backward() run through every layer at once.
+ *
+ * A block of 64 columns of a 128-cell layer is under 1 MB of activations and
+ * gradients, so it is still in L2 when the next layer or the weight gradient
+ * product reads it. Batches of 64 sequences or more use one timestep per block.
+ */
+#define LSTM_BLOCK_COLUMNS 64
 
+/**
+ * @brief Stacked LSTM with a linear readout, run over sequences of column vectors.
+ *
+ * The topology lists the input size, the hidden size of each LSTM layer and
+ * the output size: {1, 32, 1} is one LSTM layer of 32 cells reading a scalar
+ * series and predicting a scalar. A sequence is a matrix with one column per
+ * timestep. The hidden and cell states are carried from one forward() to the
+ * next until reset_state(), so a long series can be fed window by window.
+ *
+ * A mini-batch of B sequences is one time-major matrix: columns t * B to
+ * t * B + B - 1 hold timestep t of every sequence, see interleave(). The
+ * states are [H x B], so every timestep is one product over the whole batch,
+ * and the gradients are averaged over the timesteps and the sequences.
+ *
+ * The four gates of a layer share one [4H x (X+H)] weight matrix applied to
+ * the layer input stacked on the previous hidden state, so a timestep costs
+ * one matrix product per layer followed by one pass of gate nonlinearities.
+ * Row blocks of H are the input, forget, output and candidate gates.
+ *
+ * forward() records the gate activations and states in one contiguous buffer
+ * per layer and runs the layers one at a time over blocks of timesteps, so
+ * the input projections and the weight gradients are a single product per
+ * block and backward() reads activations instead of recomputing them. With
+ * gradient checkpointing, only the states at the start of every segment are
+ * kept and backward() runs the segments forward again one at a time.
+ */
 class LSTM
 {
   public:
-  std::vector<Eigen::MatrixXd> dW;
-  std::vector<Eigen::MatrixXd> db;
+  std::vector<Eigen::MatrixXd> dW; /**< Gradients of the stacked gate weights of every layer. */
+  std::vector<Eigen::MatrixXd> db; /**< Gradients of the stacked gate biases of every layer. */
+  Eigen::MatrixXd              dV; /**< Gradient of the readout weights. */
+  Eigen::MatrixXd              dc; /**< Gradient of the readout bias. */
 
-  LSTM(const std::vector<int> &topology);
+  /**
+   * @brief Constructor.
+   * @param topology Input size, hidden size of every LSTM layer, output size.
+   * @param bptt_window Timesteps per truncated backpropagation window of train().
+   */
+  LSTM(const std::vector<int> &topology, int bptt_window = LSTM_BPTT_WINDOW);
   ~LSTM();
 
-  void forward(const Eigen::MatrixXd &inputs);
+  /**
+   * @brief Zero the hidden and cell states, to be called before unrelated sequences.
+   * @param batch Number of sequences run side by side.
+   */
+  void reset_state(int batch = 1);
+
+  /**
+   * @brief Run the network over a batch of sequences, starting from the carried state.
+   *
+   * The gate activations and states of every timestep are kept for backward().
+   * The state is reset when the batch size differs from the carried one.
+   *
+   * @param inputs Time-major sequences, batch columns per timestep.
+   * @param batch Number of sequences.
+   */
+  void forward(const Eigen::MatrixXd &inputs, int batch = 1);
+
+  /**
+   * @brief Backpropagate through the timesteps of the last forward().
+   *
+   * The output gradients come from the loss set by set_loss(), and the
+   * gradients are averaged over the timesteps and the sequences. Nothing
+   * flows back past the first timestep, which truncates the backpropagation.
+   *
+   * @param inputs Sequences given to the last forward().
+   * @param targets Expected outputs, laid out like the inputs.
+   */
   void backward(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets);
-  void train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate);
-  void train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate, int num_epochs, int batch_size);
 
-  Eigen::MatrixXd get_output()
-  {
-    // Assuming output is the last hidden state
-    return hidden_state_.back();
-  }
+  /**
+   * @brief Apply the gradients of the last backward().
+   * @param learning_rate Learning rate.
+   */
+  void update(double learning_rate);
 
-  void initialize_gradients()
-  {
-    dW.resize(topology_.size() - 1);
-    db.resize(topology_.size() - 1);
-    for(size_t i = 0; i < topology_.size() - 1; ++i)
-      {
-        dW[i] = Eigen::MatrixXd::Zero(W_[i].rows(), W_[i].cols());
-        db[i] = Eigen::MatrixXd::Zero(b_[i].rows(), b_[i].cols());
-      }
-  }
+  /**
+   * @brief Train on a batch of sequences with truncated backpropagation through time.
+   *
+   * The state is reset, then the sequences are run window by window, the
+   * state flowing from one window to the next, and the weights are updated
+   * after every window.
+   *
+   * @param inputs Time-major sequences, batch columns per timestep.
+   * @param targets Expected outputs, laid out like the inputs.
+   * @param learning_rate Learning rate.
+   * @param batch Number of sequences.
+   * @return Loss over the sequences.
+   */
+  double train_batch(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate, int batch);
+
+  /**
+   * @brief Train on one sequence with truncated backpropagation through time.
+   * @param inputs Sequence, one column of inputs per timestep.
+   * @param targets Expected outputs, one column per timestep.
+   * @param learning_rate Learning rate.
+   * @return Loss over the sequence.
+   */
+  double train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate) { return train_batch(inputs, targets, learning_rate, 1); }
+
+  /**
+   * @brief Train on one long series for several epochs.
+   *
+   * The series is cut into batch_size contiguous streams of equal length
+   * that are trained side by side, a remainder shorter than batch_size
+   * timesteps is dropped.
+   *
+   * @param inputs Series, one column of inputs per timestep.
+   * @param targets Expected outputs, one column per timestep.
+   * @param learning_rate Learning rate.
+   * @param num_epochs Number of passes over the series.
+   * @param batch_size Number of streams.
+   * @return Loss of the last epoch.
+   */
+  double train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate, int num_epochs, int batch_size = 1);
+
+  /**
+   * @brief Cut a series into contiguous streams laid out time-major.
+   * @param series Series, one column per timestep.
+   * @param batch Number of streams.
+   * @return Matrix with batch columns per timestep, column t * batch + b is timestep t of stream b.
+   */
+  static Eigen::MatrixXd interleave(const Eigen::MatrixXd &series, int batch);
+
+  /**
+   * @brief Get the outputs of the last forward().
+   * @return Outputs, laid out like the inputs.
+   */
+  const Eigen::MatrixXd &get_output() const { return outputs_; }
+
+  /**
+   * @brief Get the number of timesteps per backpropagation window.
+   * @return Window of train().
+   */
+  int get_bptt_window() const { return bptt_window_; }
+
+  /**
+   * @brief Set the number of timesteps per backpropagation window.
+   * @param window Window of train(), at least 1.
+   */
+  void set_bptt_window(int window) { bptt_window_ = std::max(window, 1); }
+
+  /**
+   * @brief Get the number of timesteps per checkpointed segment.
+   * @return Segment length, 0 when the whole window is kept.
+   */
+  int get_checkpoint_every() const { return checkpoint_every_; }
+
+  /**
+   * @brief Trade memory for compute on long windows.
+   *
+   * The activations of a window take 7H values per timestep and sequence in
+   * every layer. With segments of S timesteps, forward() keeps only one
+   * segment of them plus two states per segment, and backward() runs every
+   * segment but the last one forward a second time.
+   *
+   * @param steps Segment length, 0 to keep the whole window.
+   */
+  void set_checkpoint_every(int steps) { checkpoint_every_ = std::max(steps, 0); }
+
+  /**
+   * @brief Get the loss minimized by train().
+   * @return Loss function, MSE by default.
+   */
+  const Loss &get_loss() const { return loss_; }
+
+  /**
+   * @brief Set the loss minimized by train() and backpropagated by backward().
+   *
+   * The outputs stay the raw readout, Loss::predict() maps them to the
+   * probabilities of the cross entropies.
+   *
+   * @param loss Loss function.
+   */
+  void set_loss(const Loss &loss) { loss_ = loss; }
+
+  /**
+   * @brief Zero the gradients.
+   */
+  void initialize_gradients();
 
   private:
-  std::vector<int>             topology_;
-  std::vector<Eigen::MatrixXd> W_; // Weight matrices
-  std::vector<Eigen::MatrixXd> b_; // Bias matrices
-  std::vector<Eigen::MatrixXd> cell_state_;
-  std::vector<Eigen::MatrixXd> hidden_state_;
-  // Add any other necessary private variables or methods
+  /**
+   * @brief Activations of one layer over a segment, batch columns per timestep.
+   *
+   * The buffers only grow, so a steady window and batch size never allocate.
+   */
+  struct Tape
+  {
+    Eigen::MatrixXd gates;        /**< Activated gates, stacked like the weights. */
+    Eigen::MatrixXd cell;         /**< Cell states. */
+    Eigen::MatrixXd cell_tanh;    /**< Hyperbolic tangent of the cell states. */
+    Eigen::MatrixXd hidden;       /**< Hidden states. */
+    Eigen::MatrixXd start_cell;   /**< Cell state at the start of every segment. */
+    Eigen::MatrixXd start_hidden; /**< Hidden state at the start of every segment. */
+    Eigen::MatrixXd dgates;       /**< Gradients of the gate pre-activations over a block, written by backward(). */
+    Eigen::MatrixXd dhidden;      /**< Gradients reaching the hidden states from above over a block, written by backward(). */
+  };
+
+  /**
+   * @brief Run every layer over one segment from its recorded start state.
+   * @param inputs Sequences given to forward().
+   * @param segment Index of the segment.
+   * @param first First timestep of the segment.
+   * @param count Number of timesteps of the segment.
+   */
+  void forward_segment(const Eigen::MatrixXd &inputs, int segment, int first, int count);
+
+  std::vector<int>             topology_;             /**< Input size, hidden sizes, output size. */
+  int                          layers_;               /**< Number of LSTM layers. */
+  int                          bptt_window_;          /**< Timesteps per window of train(). */
+  int                          batch_            = 1; /**< Number of sequences of the carried state. */
+  int                          checkpoint_every_ = 0; /**< Timesteps per checkpointed segment, 0 to keep the whole window. */
+  int                          tape_segment_     = 0; /**< Segment currently held by the tape. */
+  std::vector<Eigen::MatrixXd> W_;                    /**< Stacked [4H x (X+H)] gate weights of every layer. */
+  std::vector<Eigen::MatrixXd> b_;                    /**< Stacked [4H x 1] gate biases of every layer. */
+  Eigen::MatrixXd              V_;                    /**< Readout weights. */
+  Eigen::MatrixXd              c_;                    /**< Readout bias. */
+  Loss                         loss_;                 /**< Loss minimized by train(). */
+  std::vector<Eigen::MatrixXd> cell_state_;           /**< Carried cell state of every layer. */
+  std::vector<Eigen::MatrixXd> hidden_state_;         /**< Carried hidden state of every layer. */
+  std::vector<Tape>            tape_;                 /**< Activations of every layer of the last forward(). */
+  Eigen::MatrixXd              outputs_;              /**< Outputs of the last forward(). */
 };
 
-#endif // LSTM_H
\ No newline at end of file
+#endif // LSTM_H
@@ -0,0 +1,82 @@
+#include "loss.hh"
+
+using namespace Eigen;
+
+// log(1 + exp(x)) without overflow for large x and without rounding 1 + exp(x) to 1 for very negative x
+template <typename Derived> static auto softplus(const ArrayBase<Derived> &x) { return x.max(0.0) + (-x.abs()).exp().log1p(); }
+
+// log of the sum of the exponentials of every column, shifted by the column maximum
+static RowVectorXd log_sum_exp(const MatrixXd &logits)
+{
+  RowVectorXd shift = logits.colwise().maxCoeff();
+  return ((logits.rowwise() - shift).array().exp().colwise().sum().log() + shift.array()).matrix();
+}
+
+double Loss::value(const MatrixXd &outputs, const MatrixXd &targets) const
+{
+  if(outputs.cols() == 0) return 0.0;
+  const double columns = double(outputs.cols());
+  switch(type_)
+    {
+    case LossType::MSE: return 0.5 * (outputs - targets).squaredNorm() / columns;
+    case LossType::BinaryCrossEntropy:
+      // -y log(sigmoid(z)) - (1 - y) log(1 - sigmoid(z)) = softplus(z) - y z
+      return (softplus(outputs.array()) - targets.array() * outputs.array()).sum() / columns;
+    case LossType::CategoricalCrossEntropy:
+      // -sum y log(softmax(z)) = sum(y) lse(z) - sum y z
+      return ((targets.colwise().sum().array() * log_sum_exp(outputs).array()).sum() - (targets.array() * outputs.array()).sum()) / columns;
+    case LossType::Hinge: return (1.0 - targets.array() * outputs.array()).max(0.0).sum() / columns;
+    case LossType::Huber:
+      {
+        ArrayXXd error = (outputs - targets).array().abs();
+        return (error <= huber_delta_).select(0.5 * error.square(), huber_delta_ * (error - 0.5 * huber_delta_)).sum() / columns;
+      }
+    }
+  return 0.0;
+}
+
+void Loss::gradient(const MatrixXd &outputs, const MatrixXd &targets, MatrixXd &gradient) const
+{
+  switch(type_)
+    {
+    case LossType::MSE: gradient = outputs - targets; break;
+    case LossType::BinaryCrossEntropy: gradient = ((1.0 + (-outputs.array()).exp()).inverse() - targets.array()).matrix(); break;
+    case LossType::CategoricalCrossEntropy:
+      // softmax(z) sum(y) - y, which is the familiar softmax(z) - y for one-hot targets
+      gradient = predict(outputs);
+      gradient.array().rowwise() *= targets.colwise().sum().array();
+      gradient -= targets;
+      break;
+    case LossType::Hinge: gradient = (targets.array() * outputs.array() < 1.0).select(-targets.array(), 0.0).matrix(); break;
+    case LossType::Huber: gradient = (outputs - targets).array().max(-huber_delta_).min(huber_delta_).matrix(); break;
+    }
+}
+
+MatrixXd Loss::predict(const MatrixXd &outputs) const
+{
+  switch(type_)
+    {
+    case LossType::BinaryCrossEntropy: return (1.0 + (-outputs.array()).exp()).inverse().matrix();
+    case LossType::CategoricalCrossEntropy:
+      {
+        MatrixXd probabilities = outputs.rowwise() - outputs.colwise().maxCoeff();
+        probabilities.array()  = probabilities.array().exp();
+        probabilities.array().rowwise() /= probabilities.colwise().sum().array();
+        return probabilities;
+      }
+    default: return outputs;
+    }
+}
+
+const char *Loss::get_name() const
+{
+  switch(type_)
+    {
+    case LossType::MSE: return "MSE";
+    case LossType::BinaryCrossEntropy: return "BinaryCrossEntropy";
+    case LossType::CategoricalCrossEntropy: return "CategoricalCrossEntropy";
+    case LossType::Hinge: return "Hinge";
+    case LossType::Huber: return "Huber";
+    }
+  return "Unknown";
+}
@@ -1,197 +1,332 @@
 #include "lstm.hh"
-#include "activation.hh"
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
-
-#define MSE
+#include <stdexcept>
 
 using namespace Eigen;
 
-// Mean Squared Error (MSE) loss function
-double compute_mse_loss(const MatrixXd &targets, const MatrixXd &predictions) { return (1.0 / targets.cols()) * (targets - predictions).array().square().sum(); }
-
-// Binary Cross-Entropy loss function
-double compute_binary_crossentropy_loss(const MatrixXd &targets, const MatrixXd &predictions) { return -(1.0 / targets.cols()) * (targets.array() * predictions.array().log() + (1 - targets.array()) * (1 - predictions.array()).log()).sum(); }
+// row blocks of the stacked gate weights, in units of the hidden size
+enum Gate
+{
+  INPUT_GATE     = 0,
+  FORGET_GATE    = 1,
+  OUTPUT_GATE    = 2,
+  CANDIDATE_GATE = 3,
+  GATES          = 4
+};
 
-// Categorical Cross-Entropy loss function
-double compute_categorical_crossentropy_loss(const MatrixXd &targets, const MatrixXd &predictions) { return -(1.0 / targets.cols()) * (targets.array() * predictions.array().log()).sum(); }
+// logistic sigmoid, vectorized through the exponential
+template <typename Derived> static auto sigmoid(const ArrayBase<Derived> &x) { return (1.0 + (-x).exp()).inverse(); }
 
-// Hinge loss function
-double compute_hinge_loss(const MatrixXd &targets, const MatrixXd &predictions) { return (1.0 / targets.cols()) * (targets.array() * predictions.array()).sum(); }
+// Eigen evaluates tanh of doubles one coefficient at a time, 2 sigmoid(2x) - 1 goes through the vectorized exponential
+template <typename Derived> static auto fast_tanh(const ArrayBase<Derived> &x) { return 2.0 * (1.0 + (-2.0 * x).exp()).inverse() - 1.0; }
 
-double compute_accuracy(const MatrixXd &predictions, const MatrixXd &targets)
+LSTM::LSTM(const std::vector<int> &topology, int bptt_window) : topology_(topology), layers_(topology.size() - 2), bptt_window_(std::max(bptt_window, 1))
 {
-  int num_samples = predictions.cols();
-  int num_correct = 0;
+  if(topology_.size() < 3) throw std::invalid_argument("LSTM topology needs an input size, at least one hidden size and an output size");
 
-  for(int i = 0; i < num_samples; ++i)
+  W_.resize(layers_);
+  b_.resize(layers_);
+  for(int i = 0; i < layers_; ++i)
     {
-      // Find the index of the class with the highest probability
-      int    predicted_class = 0;
-      double max_probability = predictions.col(i).maxCoeff(&predicted_class);
-
-      // Compare the predicted class with the true class
-      int true_class = targets.col(i).maxCoeff();
-
-      if(predicted_class == true_class) { num_correct++; }
+      // uniform in +-1/sqrt(H), the forget gate starts open so the state is remembered early in training
+      int hidden = topology_[i + 1];
+      W_[i]      = Eigen::MatrixXd::Random(GATES * hidden, topology_[i] + hidden) / std::sqrt(double(hidden));
+      b_[i]      = Eigen::MatrixXd::Zero(GATES * hidden, 1);
+      b_[i].middleRows(FORGET_GATE * hidden, hidden).setOnes();
     }
+  V_ = Eigen::MatrixXd::Random(topology_.back(), topology_[layers_]) / std::sqrt(double(topology_[layers_]));
+  c_ = Eigen::MatrixXd::Zero(topology_.back(), 1);
 
-  // Compute and return accuracy
-  return static_cast<double>(num_correct) / num_samples;
+  initialize_gradients();
+  reset_state();
 }
 
-// Alias for compute_loss based on selected loss function
-#ifdef MSE
-#define compute_loss compute_mse_loss
-#elif defined(BINARY_CROSSENTROPY)
-#define compute_loss compute_binary_crossentropy_loss
-#elif defined(CATEGORICAL_CROSSENTROPY)
-#define compute_loss compute_categorical_crossentropy_loss
-#elif defined(HINGE)
-#define compute_loss compute_hinge_loss
-#else
-#error "Please define a loss function using preprocessor directives (e.g., -DMSE)"
-#endif
-
-LSTM::LSTM(const std::vector<int> &topology) : topology_(topology)
-{
-  W_.resize(topology_.size() - 1);
-  b_.resize(topology_.size() - 1);
+LSTM::~LSTM() {}
 
-  for(size_t i = 0; i < topology_.size() - 1; ++i)
+void LSTM::initialize_gradients()
+{
+  dW.resize(W_.size());
+  db.resize(b_.size());
+  for(size_t i = 0; i < W_.size(); ++i)
     {
-      W_[i] = Eigen::MatrixXd::Random(topology_[i + 1], topology_[i]);
-      b_[i] = Eigen::MatrixXd::Random(topology_[i + 1], 1);
+      dW[i] = Eigen::MatrixXd::Zero(W_[i].rows(), W_[i].cols());
+      db[i] = Eigen::MatrixXd::Zero(b_[i].rows(), b_[i].cols());
     }
-  initialize_gradients();
+  dV = Eigen::MatrixXd::Zero(V_.rows(), V_.cols());
+  dc = Eigen::MatrixXd::Zero(c_.rows(), c_.cols());
 }
 
-void LSTM::forward(const Eigen::MatrixXd &inputs)
+void LSTM::reset_state(int batch)
 {
-  // Initialize cell and hidden states for the first timestep
-  cell_state_.resize(topology_.size());
-  hidden_state_.resize(topology_.size());
-  cell_state_[0]   = Eigen::MatrixXd::Zero(topology_[0], 1);
-  hidden_state_[0] = Eigen::MatrixXd::Zero(topology_[0], 1);
-
-  // Forward pass through the LSTM layers
-  for(size_t i = 0; i < topology_.size() - 1; ++i)
+  batch_ = std::max(batch, 1);
+  cell_state_.resize(layers_);
+  hidden_state_.resize(layers_);
+  for(int i = 0; i < layers_; ++i)
     {
-      // Compute input to the current layer
-      Eigen::MatrixXd layer_input;
-      if(i == 0) { layer_input = inputs; }
-      else { layer_input = hidden_state_[i - 1]; }
-
-      // Compute input gate, forget gate, output gate, and candidate cell state for the current layer
-      Eigen::MatrixXd input_gate           = ActivationFunction::sigmoid(W_[i] * layer_input + b_[i]);
-      Eigen::MatrixXd forget_gate          = ActivationFunction::sigmoid(W_[i] * layer_input + b_[i + topology_.size() - 1]);
-      Eigen::MatrixXd output_gate          = ActivationFunction::sigmoid(W_[i] * layer_input + b_[i + 2 * (topology_.size() - 1)]);
-      Eigen::MatrixXd candidate_cell_state = ActivationFunction::tanh(W_[i] * layer_input + b_[i + 3 * (topology_.size() - 1)]);
-
-      // Update cell state for the current layer
-      cell_state_[i + 1] = input_gate.array() * candidate_cell_state.array() + forget_gate.array() * cell_state_[i].array();
-
-      // Update hidden state for the current layer
-      hidden_state_[i + 1] = output_gate.array() * ActivationFunction::tanh(cell_state_[i + 1]).array();
+      cell_state_[i]   = Eigen::MatrixXd::Zero(topology_[i + 1], batch_);
+      hidden_state_[i] = Eigen::MatrixXd::Zero(topology_[i + 1], batch_);
     }
 }
 
-void LSTM::backward(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets)
+// grow a tape buffer, never shrink it, so a steady window and batch size do not allocate
+static void reserve(Eigen::MatrixXd &buffer, Index rows, Index cols)
 {
-  // Initialize gradients
-
-  Eigen::MatrixXd dcell_state   = Eigen::MatrixXd::Zero(topology_.back(), 1);
-  Eigen::MatrixXd dhidden_state = Eigen::MatrixXd::Zero(topology_.back(), 1);
-  Eigen::MatrixXd delta;
-
-  // Perform backward pass through the LSTM layers
-  for(int i = topology_.size() - 1; i > 0; --i)
-    {
-      // Compute gradients for output layer
-      if(i == topology_.size() - 1) { delta = hidden_state_[i] - targets; }
-      else { delta = W_[i + 1].transpose() * delta; }
-
-      Eigen::MatrixXd dsigmoid_activation = ActivationFunction::sigmoid_derivative(hidden_state_[i]);
-      Eigen::MatrixXd dhidden             = delta.array() * dsigmoid_activation.array();
+  if(buffer.rows() != rows || buffer.cols() < cols) buffer.resize(rows, std::max(cols, buffer.cols()));
+}
 
-      // Compute gradients for input gate
-      Eigen::MatrixXd dsigmoid_input_gate = ActivationFunction::sigmoid_derivative(W_[i] * hidden_state_[i - 1] + b_[i]);
-      Eigen::MatrixXd dinput_gate         = dhidden.array() * ActivationFunction::tanh(cell_state_[i]).array() * dsigmoid_input_gate.array();
+void LSTM::forward(const Eigen::MatrixXd &inputs, int batch)
+{
+  if(batch < 1 || inputs.cols() % batch != 0) throw std::invalid_argument("LSTM inputs must hold the same number of timesteps for every sequence of the batch");
+  if(batch != batch_) reset_state(batch);
 
-      // Compute gradients for forget gate
-      Eigen::MatrixXd dsigmoid_forget_gate = ActivationFunction::sigmoid_derivative(W_[i] * hidden_state_[i - 1] + b_[i]);
-      Eigen::MatrixXd dforget_gate         = dhidden.array() * hidden_state_[i - 1].array() * dsigmoid_forget_gate.array();
+  const int steps    = inputs.cols() / batch;
+  const int segment  = checkpoint_every_ > 0 ? std::min(checkpoint_every_, steps) : steps;
+  const int segments = segment > 0 ? (steps + segment - 1) / segment : 0;
 
-      // Compute gradients for output gate
-      Eigen::MatrixXd dsigmoid_output_gate = ActivationFunction::sigmoid_derivative(W_[i] * hidden_state_[i - 1] + b_[i]);
-      Eigen::MatrixXd doutput_gate         = dhidden.array() * ActivationFunction::tanh(cell_state_[i]).array() * dsigmoid_output_gate.array();
+  tape_.resize(layers_);
+  for(int i = 0; i < layers_; ++i)
+    {
+      const int hidden = topology_[i + 1];
+      Tape     &tape   = tape_[i];
+      reserve(tape.gates, GATES * hidden, Index(segment) * batch);
+      for(auto *buffer : {&tape.cell, &tape.cell_tanh, &tape.hidden}) reserve(*buffer, hidden, Index(segment) * batch);
+      for(auto *buffer : {&tape.start_cell, &tape.start_hidden}) reserve(*buffer, hidden, Index(segments) * batch);
+    }
+  outputs_.resize(topology_.back(), inputs.cols());
 
-      // Compute gradients for candidate cell state
-      Eigen::MatrixXd dtanh_candidate_cell_state = ActivationFunction::tanh_derivative(W_[i] * hidden_state_[i - 1] + b_[i]);
-      Eigen::MatrixXd dcell                      = dhidden.array() * ActivationFunction::sigmoid(W_[i] * hidden_state_[i - 1] + b_[i]).array() * dtanh_candidate_cell_state.array();
+  for(int k = 0; k < segments; ++k)
+    {
+      const int first = k * segment;
+      const int count = std::min(segment, steps - first);
+      for(int i = 0; i < layers_; ++i)
+        {
+          tape_[i].start_cell.middleCols(k * batch, batch)   = cell_state_[i];
+          tape_[i].start_hidden.middleCols(k * batch, batch) = hidden_state_[i];
+        }
 
-      // Update gradients
-      dW[i] = dcell * hidden_state_[i - 1].transpose();
-      db[i] = dcell;
-      dcell_state += (dcell.array() * ActivationFunction::sigmoid(W_[i] * hidden_state_[i - 1] + b_[i]).array()).matrix();
-      dhidden_state += ((W_[i] * dcell).array() * ActivationFunction::sigmoid(b_[i]).array()).matrix();
+      forward_segment(inputs, k, first, count);
+      for(int i = 0; i < layers_; ++i)
+        {
+          cell_state_[i]   = tape_[i].cell.middleCols((count - 1) * batch, batch);
+          hidden_state_[i] = tape_[i].hidden.middleCols((count - 1) * batch, batch);
+        }
 
-      // Propagate gradients to the previous timestep
-      if(i > 1) { delta = dhidden_state; }
+      auto output     = outputs_.middleCols(first * batch, count * batch);
+      output.noalias() = V_ * tape_.back().hidden.leftCols(count * batch);
+      output.colwise() += c_.col(0);
     }
 }
 
-void LSTM::train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate)
+void LSTM::forward_segment(const Eigen::MatrixXd &inputs, int segment, int first, int count)
 {
-  // Training implementation
-  forward(inputs);
-  backward(inputs, targets);
-  // Update weights and biases
-  for(size_t i = 0; i < topology_.size() - 1; ++i)
+  const int batch = batch_;
+  const int block = std::max(1, LSTM_BLOCK_COLUMNS / batch);
+  for(int start = 0; start < count; start += block)
     {
-      W_[i] -= learning_rate * dW[i];
-      b_[i] -= learning_rate * db[i];
+      // every layer runs over one block before the next block starts, so the block stays in cache between layers
+      const Index offset = Index(start) * batch;
+      const Index cols   = Index(std::min(block, count - start)) * batch;
+      for(int i = 0; i < layers_; ++i)
+        {
+          const int hidden = topology_[i + 1];
+          Tape     &tape   = tape_[i];
+          auto      gates  = tape.gates.middleCols(offset, cols);
+
+          // the input projection does not depend on the recurrence, one product covers the whole block
+          if(i == 0) gates.noalias() = W_[i].leftCols(topology_[i]) * inputs.middleCols(Index(first) * batch + offset, cols);
+          else gates.noalias() = W_[i].leftCols(topology_[i]) * tape_[i - 1].hidden.middleCols(offset, cols);
+          gates.colwise() += b_[i].col(0);
+
+          for(Index column = offset; column < offset + cols; column += batch)
+            {
+              auto previous = column > 0 ? tape.hidden.middleCols(column - batch, batch) : tape.start_hidden.middleCols(Index(segment) * batch, batch);
+              tape.gates.middleCols(column, batch).noalias() += W_[i].rightCols(hidden) * previous;
+
+              // the nonlinearities run one sequence at a time, so the [4H x 1] gates stay in L1 through every pass
+              for(int j = 0; j < batch; ++j)
+                {
+                  auto gate          = tape.gates.col(column + j);
+                  auto previous_cell = column > 0 ? tape.cell.col(column - batch + j) : tape.start_cell.col(Index(segment) * batch + j);
+                  gate.head(CANDIDATE_GATE * hidden).array() = sigmoid(gate.head(CANDIDATE_GATE * hidden).array());
+                  gate.tail(hidden).array()                  = fast_tanh(gate.tail(hidden).array());
+
+                  auto input_gate  = gate.segment(INPUT_GATE * hidden, hidden).array();
+                  auto forget_gate = gate.segment(FORGET_GATE * hidden, hidden).array();
+                  auto output_gate = gate.segment(OUTPUT_GATE * hidden, hidden).array();
+                  auto candidate   = gate.segment(CANDIDATE_GATE * hidden, hidden).array();
+
+                  auto cell                           = tape.cell.col(column + j).array();
+                  auto cell_tanh                      = tape.cell_tanh.col(column + j).array();
+                  cell                                = input_gate * candidate + forget_gate * previous_cell.array();
+                  cell_tanh                           = fast_tanh(cell);
+                  tape.hidden.col(column + j).array() = output_gate * cell_tanh;
+                }
+            }
+        }
     }
+  tape_segment_ = segment;
 }
 
-void LSTM::train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate, int num_epochs, int batch_size)
+void LSTM::backward(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets)
 {
-  int num_batches = inputs.cols() / batch_size;
-  if(inputs.cols() % batch_size != 0) { num_batches++; }
+  const int batch    = batch_;
+  const int steps    = inputs.cols() / batch;
+  const int segment  = checkpoint_every_ > 0 ? std::min(checkpoint_every_, steps) : steps;
+  const int segments = segment > 0 ? (steps + segment - 1) / segment : 0;
+  initialize_gradients();
 
-  for(int epoch = 0; epoch < num_epochs; ++epoch)
+  // gradients reaching the previous timestep through the recurrent connections
+  const int                    block = std::max(1, LSTM_BLOCK_COLUMNS / batch);
+  std::vector<Eigen::MatrixXd> dhidden_next(layers_), dcell_next(layers_);
+  for(int i = 0; i < layers_; ++i)
     {
-      double total_loss = 0.0;
-      for(int batch = 0; batch < num_batches; ++batch)
-        {
-          int start_idx = batch * batch_size;
-          int end_idx   = std::min((long long)(batch + 1) * batch_size, inputs.cols());
-
-          MatrixXd batch_inputs  = inputs.middleCols(start_idx, end_idx - start_idx);
-          MatrixXd batch_targets = targets.middleCols(start_idx, end_idx - start_idx);
-
-          // Forward pass
-          forward(batch_inputs);
+      dhidden_next[i] = Eigen::MatrixXd::Zero(topology_[i + 1], batch);
+      dcell_next[i]   = Eigen::MatrixXd::Zero(topology_[i + 1], batch);
+      reserve(tape_[i].dgates, GATES * topology_[i + 1], Index(block) * batch);
+      reserve(tape_[i].dhidden, topology_[i + 1], Index(block) * batch);
+    }
 
-          // Backward pass
-          backward(batch_inputs, batch_targets);
+  Eigen::MatrixXd delta;
+  loss_.gradient(outputs_, targets, delta);
+  dc = delta.rowwise().sum();
+  for(int k = segments - 1; k >= 0; --k)
+    {
+      const int first = k * segment;
+      const int count = std::min(segment, steps - first);
 
-          // Update weights and biases
-          for(size_t i = 0; i < topology_.size() - 1; ++i)
+      // the tape holds the last segment after forward(), the others are run again from their checkpoint
+      if(k != tape_segment_) forward_segment(inputs, k, first, count);
+      for(int start = ((count - 1) / block) * block; start >= 0; start -= block)
+        {
+          // blocks in reverse, every layer from the top, like forward_segment() in the other direction
+          const Index offset      = Index(start) * batch;
+          const Index cols        = Index(std::min(block, count - start)) * batch;
+          auto        block_delta = delta.middleCols(Index(first) * batch + offset, cols);
+          dV.noalias() += block_delta * tape_.back().hidden.middleCols(offset, cols).transpose();
+          tape_.back().dhidden.leftCols(cols).noalias() = V_.transpose() * block_delta;
+
+          for(int i = layers_ - 1; i >= 0; --i)
             {
-              W_[i] -= learning_rate * dW[i];
-              b_[i] -= learning_rate * db[i];
+              const int hidden = topology_[i + 1];
+              Tape     &tape   = tape_[i];
+              auto      dgates = tape.dgates.leftCols(cols);
+              auto      dabove = tape.dhidden.leftCols(cols);
+
+              for(Index local = cols - batch; local >= 0; local -= batch)
+                {
+                  const Index column = offset + local;
+
+                  // one sequence at a time, like the nonlinearities of forward()
+                  for(int j = 0; j < batch; ++j)
+                    {
+                      auto gate          = tape.gates.col(column + j);
+                      auto cell_tanh     = tape.cell_tanh.col(column + j).array();
+                      auto previous_cell = column > 0 ? tape.cell.col(column - batch + j) : tape.start_cell.col(Index(k) * batch + j);
+
+                      auto input_gate  = gate.segment(INPUT_GATE * hidden, hidden).array();
+                      auto forget_gate = gate.segment(FORGET_GATE * hidden, hidden).array();
+                      auto output_gate = gate.segment(OUTPUT_GATE * hidden, hidden).array();
+                      auto candidate   = gate.segment(CANDIDATE_GATE * hidden, hidden).array();
+
+                      // the recurrent gradients become the full gradients of this timestep in place
+                      auto dhidden = dhidden_next[i].col(j).array();
+                      auto dcell   = dcell_next[i].col(j).array();
+                      dhidden += dabove.col(local + j).array();
+                      dcell += dhidden * output_gate * (1.0 - cell_tanh.square());
+
+                      // gradients of the gate pre-activations, from the activations kept by forward()
+                      auto dgate                                             = dgates.col(local + j);
+                      dgate.segment(INPUT_GATE * hidden, hidden).array()     = dcell * candidate * input_gate * (1.0 - input_gate);
+                      dgate.segment(FORGET_GATE * hidden, hidden).array()    = dcell * previous_cell.array() * forget_gate * (1.0 - forget_gate);
+                      dgate.segment(OUTPUT_GATE * hidden, hidden).array()    = dhidden * cell_tanh * output_gate * (1.0 - output_gate);
+                      dgate.segment(CANDIDATE_GATE * hidden, hidden).array() = dcell * input_gate * (1.0 - candidate.square());
+                      dcell *= forget_gate;
+                    }
+                  dhidden_next[i].noalias() = W_[i].rightCols(hidden).transpose() * dgates.middleCols(local, batch);
+                }
+
+              // the weight gradients and the gradient sent below are one product over the block
+              if(i == 0) dW[i].leftCols(topology_[i]).noalias() += dgates * inputs.middleCols(Index(first) * batch + offset, cols).transpose();
+              else dW[i].leftCols(topology_[i]).noalias() += dgates * tape_[i - 1].hidden.middleCols(offset, cols).transpose();
+              if(offset > 0) dW[i].rightCols(hidden).noalias() += dgates * tape.hidden.middleCols(offset - batch, cols).transpose();
+              else
+                {
+                  dW[i].rightCols(hidden).noalias() += dgates.leftCols(batch) * tape.start_hidden.middleCols(Index(k) * batch, batch).transpose();
+                  dW[i].rightCols(hidden).noalias() += dgates.rightCols(cols - batch) * tape.hidden.leftCols(cols - batch).transpose();
+                }
+              db[i] += dgates.rowwise().sum();
+              if(i > 0) tape_[i - 1].dhidden.leftCols(cols).noalias() = W_[i].leftCols(topology_[i]).transpose() * dgates;
             }
-
-          // Compute and accumulate loss (you need to define a method to compute loss)
-          total_loss += compute_loss(batch_targets, get_output());
         }
+    }
 
-      // Calculate accuracy or any other metric
-      double accuracy = compute_accuracy(inputs, targets);
+  // mean over the timesteps and the sequences, so the learning rate depends on neither the window nor the batch
+  double scale = steps > 0 ? 1.0 / (double(steps) * batch) : 0.0;
+  for(size_t i = 0; i < dW.size(); ++i)
+    {
+      dW[i] *= scale;
+      db[i] *= scale;
+    }
+  dV *= scale;
+  dc *= scale;
+}
 
-      // Print epoch and accuracy
-      std::cout << "Epoch " << epoch << ", Loss: " << total_loss << ", Accuracy: " << accuracy << std::endl;
+void LSTM::update(double learning_rate)
+{
+  for(size_t i = 0; i < W_.size(); ++i)
+    {
+      W_[i] -= learning_rate * dW[i];
+      b_[i] -= learning_rate * db[i];
+    }
+  V_ -= learning_rate * dV;
+  c_ -= learning_rate * dc;
+}
+
+double LSTM::train_batch(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate, int batch)
+{
+  double total_loss = 0.0;
+  reset_state(batch);
+  const Index window = Index(bptt_window_) * batch_;
+  for(Index start = 0; start < inputs.cols(); start += window)
+    {
+      // the state flows into the next window, the gradients stop at its first timestep
+      Index           count          = std::min<Index>(window, inputs.cols() - start);
+      Eigen::MatrixXd window_inputs  = inputs.middleCols(start, count);
+      Eigen::MatrixXd window_targets = targets.middleCols(start, count);
+
+      forward(window_inputs, batch_);
+      backward(window_inputs, window_targets);
+      update(learning_rate);
+      total_loss += loss_.value(get_output(), window_targets) * count;
+    }
+  return inputs.cols() > 0 ? total_loss / inputs.cols() : 0.0;
+}
+
+double LSTM::train(const Eigen::MatrixXd &inputs, const Eigen::MatrixXd &targets, double learning_rate, int num_epochs, int batch_size)
+{
+  // the layout only depends on the series, build it once for every epoch
+  batch_size                     = std::max(batch_size, 1);
+  Eigen::MatrixXd stream_inputs  = interleave(inputs, batch_size);
+  Eigen::MatrixXd stream_targets = interleave(targets, batch_size);
+
+  double loss = 0.0;
+  for(int epoch = 0; epoch < num_epochs; ++epoch)
+    {
+      loss = train_batch(stream_inputs, stream_targets, learning_rate, batch_size);
+      std::cout << "Epoch " << epoch << ", Loss: " << loss << std::endl;
     }
+  return loss;
+}
+
+Eigen::MatrixXd LSTM::interleave(const Eigen::MatrixXd &series, int batch)
+{
+  batch             = std::max(batch, 1);
+  const Index steps = series.cols() / batch;
+  Eigen::MatrixXd out(series.rows(), steps * batch);
+  for(Index b = 0; b < batch; ++b)
+    for(Index t = 0; t < steps; ++t) out.col(t * batch + b) = series.col(b * steps + t);
+  return out;
 }
@@ -13,33 +13,80 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include <Eigen/Dense>
 #include "activation.hh"
+#include "optimizer.hh"
 
 #define ROW_SEPARATOR      "\n"
 #define MATRIX_SEPARATOR   "END-MATRIX"
 #define TOPOLOGY_SEPARATOR "TOPOLOGY"
 #define COLUMN_SEPARATOR   ","
 
+/**
+ * @brief Number of samples scored at a time by the chunked predict().
+ */
+#define NN_PREDICT_BATCH 256
+
 using namespace Eigen;
 using namespace std;
 
 /**
- * @brief The AndresNeuralNetwork class represents a neural network.
+ * @brief The BasicNeuralNetwork class represents a neural network.
+ *
+ * The scalar type of the weights, activations and gradients is a template
+ * parameter. It is instantiated for double and float in NN.cc, see the
+ * AndresNeuralNetwork and AndresNeuralNetworkF aliases below.
+ *
+ * @tparam Scalar Floating point type, double or float.
  */
-class AndresNeuralNetwork
+template <typename Scalar> class BasicNeuralNetwork
 {
+  template <typename> friend class BasicNeuralNetwork;
+
+  public:
+  typedef Eigen::Matrix<Scalar, Dynamic, Dynamic> Matrix; /**< Matrix of the network scalar type. */
+  typedef Eigen::Matrix<Scalar, Dynamic, 1>       Vector; /**< Column vector of the network scalar type. */
+
+  /**
+   * @brief Buffers of one forward and backward pass.
+   *
+   * The network owns one workspace for its single-threaded API. Trainers that
+   * split a batch across threads give every thread its own workspace and run
+   * the const passes below against the shared weights.
+   */
+  struct Workspace
+  {
+    vector<Matrix> activations;      /**< Activations, one column per sample. */
+    vector<Matrix> deltas;           /**< Deltas, one column per sample. */
+    vector<Matrix> weight_gradients; /**< Weight gradients summed over the columns. */
+    vector<Vector> bias_gradients;   /**< Bias gradients summed over the columns. */
+    int            capacity = 0;     /**< Number of columns the buffers are sized for. */
+    int            cols     = 0;     /**< Number of columns used by the last forward pass. */
+  };
+
   private:
-  vector<int>         topology;            /**< Topology of the neural network. */
-  vector<MatrixXd>    weights;             /**< Weights of the neural network. */
-  vector<MatrixXd>    prev_weight_update;  /**< Previous weight update for momentum. */
-  vector<VectorXd>    biases;              /**< Biases of the neural network. */
-  vector<VectorXd>    activations;         /**< Activations of the neural network. */
-  vector<VectorXd>    deltas;              /**< Deltas of the neural network. */
-  double              learning_rate;       /**< Learning rate of the neural network. */
-  double              momentum;            /**< Momentum of the neural network. */
-  ActivationFunction *activation_function; /**< Activation function of the neural network. */
+  vector<int>                             topology;         /**< Topology of the neural network. */
+  vector<Matrix>                          weights;          /**< Weights of the neural network. */
+  vector<Vector>                          biases;           /**< Biases of the neural network. */
+  Workspace                               workspace;        /**< Workspace of the single-threaded API. */
+  std::unique_ptr<BasicOptimizer<Scalar>> optimizer;        /**< Optimizer updating weights and biases. */
+  vector<ActivationType>                  activation_types; /**< Activation function of each layer. */
+
+  /**
+   * @brief Load weights from a file in the legacy text format.
+   * @param filename Name of the file to load weights from.
+   * @return True if weights are successfully loaded, false otherwise.
+   */
+  bool loadLegacyWeights(const std::string &filename);
+
+  /**
+   * @brief Size weights, biases, optimizer state and workspaces for the current topology.
+   *
+   * Weights and biases are left uninitialized.
+   */
+  void allocateLayers();
 
   public:
   /**
@@ -47,42 +94,145 @@ class AndresNeuralNetwork
    * @param topology Topology of the neural network.
    * @param learning_rate Learning rate of the neural network.
    * @param momentum Momentum of the neural network.
-   * @param activation_function Activation function of the neural network.
+   * @param activation Activation function of every layer, Softmax only sets the output layer and leaves Sigmoid on the hidden ones.
    */
-  AndresNeuralNetwork(const vector<int> &topology, double learning_rate, double momentum, ActivationFunction *activation_function);
+  BasicNeuralNetwork(const vector<int> &topology, double learning_rate, double momentum, ActivationType activation = ActivationType::Sigmoid);
+
+  /**
+   * @brief Constructor with one activation function per layer.
+   * @param topology Topology of the neural network.
+   * @param learning_rate Learning rate of the neural network.
+   * @param momentum Momentum of the neural network.
+   * @param activations Activation function of each layer, topology size - 1 entries.
+   */
+  BasicNeuralNetwork(const vector<int> &topology, double learning_rate, double momentum, const vector<ActivationType> &activations);
 
   /**
    * @brief Perform backpropagation in the neural network.
-   * @param target Target vector for backpropagation.
+   *
+   * Gradients are averaged over the columns of the last forward pass and a
+   * single weight update is applied for the whole batch.
+   *
+   * @param targets Target matrix for backpropagation, one column per sample.
    */
-  void backpropagation(const VectorXd &target);
+  void backpropagation(const Ref<const Matrix> &targets);
 
   /**
    * @brief Perform forward propagation in the neural network.
-   * @param input Input vector.
+   *
+   * Each layer is computed with a single matrix-matrix product over the batch,
+   * written in place into the activation workspace. A Vector input is
+   * treated as a batch of one sample. The workspaces only grow when the batch
+   * is wider than the current capacity.
+   *
+   * @param inputs Input matrix, one column per sample.
    * @param log Optional logging function.
    */
-  void forwardPropagation(const VectorXd &input, std::function<void(string)> log = nullptr);
+  void forwardPropagation(const Ref<const Matrix> &inputs, std::function<void(string)> log = nullptr);
 
   /**
    * @brief Get the results of the neural network.
    * @param log Optional logging function.
-   * @return Vector of results.
+   * @return View of the output activations, one column per sample of the last
+   * forward pass. It stays valid until the next forward pass.
+   *
+   * It reads the workspace of the single-threaded API, use predict() to score
+   * from several threads or while another thread trains.
    */
-  Eigen::VectorXd getResults(std::function<void(string)> log = nullptr) const;
+  Ref<const Matrix> getResults(std::function<void(string)> log = nullptr) const;
 
   /**
-   * @brief Load weights from a file.
+   * @brief Size the activation, delta and gradient workspaces for a batch.
+   *
+   * Call it once before training so that steady-state forward and backward
+   * passes do not touch the heap.
+   *
+   * @param capacity Largest number of samples per batch.
+   */
+  void reserveBatch(int capacity);
+
+  /**
+   * @brief Size a workspace for the current topology and a batch width.
+   * @param ws Workspace to size.
+   * @param capacity Largest number of samples per batch.
+   * @param training Whether to size the deltas and gradients too, an inference workspace only holds activations.
+   */
+  void reserveWorkspace(Workspace &ws, int capacity, bool training = true) const;
+
+  /**
+   * @brief Score a batch into a caller-owned workspace.
+   *
+   * Only reads the weights, any number of threads may predict concurrently
+   * with one workspace each.
+   *
+   * @param inputs Input matrix, one column per sample.
+   * @param ws Workspace receiving the activations, sized for inference if needed.
+   * @return View of the outputs in ws, valid until its next use.
+   */
+  Ref<const Matrix> predict(const Ref<const Matrix> &inputs, Workspace &ws) const;
+
+  /**
+   * @brief Score a batch into a workspace owned by the calling thread.
+   * @param inputs Input matrix, one column per sample.
+   * @return View of the outputs, valid until the next predict() on this thread.
+   */
+  Ref<const Matrix> predict(const Ref<const Matrix> &inputs) const;
+
+  /**
+   * @brief Score any number of samples, NN_PREDICT_BATCH at a time.
+   * @param inputs Input matrix, one column per sample.
+   * @param outputs Output matrix of the same width, one row per output neuron.
+   */
+  void predict(const Ref<const Matrix> &inputs, Ref<Matrix> outputs) const;
+
+  /**
+   * @brief Forward pass into a caller-owned workspace.
+   *
+   * Only reads the weights, so several threads may run it concurrently with
+   * their own workspaces.
+   *
+   * @param inputs Input matrix, one column per sample.
+   * @param ws Workspace receiving the activations, grown if needed.
+   */
+  void forwardPropagation(const Ref<const Matrix> &inputs, Workspace &ws) const;
+
+  /**
+   * @brief Backward pass into a caller-owned workspace.
+   *
+   * Fills the workspace gradients with the sums over its columns, without
+   * touching the weights. The loss is the squared error, or the cross-entropy
+   * when the output layer is Softmax.
+   *
+   * @param targets Target matrix, one column per sample of the last forward pass in ws.
+   * @param ws Workspace holding the forward pass.
+   */
+  void computeGradients(const Ref<const Matrix> &targets, Workspace &ws) const;
+
+  /**
+   * @brief Apply one optimizer update from summed gradients.
+   * @param weight_gradients Weight gradients summed over the batch.
+   * @param bias_gradients Bias gradients summed over the batch.
+   * @param samples Number of samples the gradients were summed over.
+   */
+  void applyGradients(const vector<Matrix> &weight_gradients, const vector<Vector> &bias_gradients, int samples);
+
+  /**
+   * @brief Load weights and biases from a file.
+   *
+   * Binary model files (see ModelFile) are memory-mapped and copied block by
+   * block. Files in the legacy text format are still accepted, without biases.
+   *
    * @param filename Name of the file to load weights from.
    * @return True if weights are successfully loaded, false otherwise.
    */
   bool loadWeights(const std::string &filename);
 
   /**
-   * @brief Save weights to a file.
+   * @brief Save weights and biases to a binary model file.
    * @param filename Name of the file to save weights to.
+   * @return True if the file was written completely, false otherwise.
    */
-  void saveWeights(const std::string &filename) const;
+  bool saveWeights(const std::string &filename) const;
 
   /**
    * @brief Set the learning rate of the neural network.
@@ -96,6 +246,21 @@ class AndresNeuralNetwork
    */
   void setAlpha(double alpha);
 
+  /**
+   * @brief Replace the optimizer, keeping the learning rate and momentum.
+   *
+   * The state of the new optimizer starts from zero.
+   *
+   * @param type Optimizer to use.
+   */
+  void setOptimizer(OptimizerType type);
+
+  /**
+   * @brief Get the optimizer of the neural network.
+   * @return Optimizer type.
+   */
+  OptimizerType getOptimizer() const { return optimizer->getType(); }
+
   /**
    * @brief Set the topology of the neural network.
    * @param newTopology New topology to set.
@@ -108,10 +273,62 @@ class AndresNeuralNetwork
    */
   std::vector<int> getTopology() const;
 
+  /**
+   * @brief Set the activation function of each layer.
+   *
+   * Softmax is only accepted on the output layer.
+   *
+   * @param activations Activation function of each layer, topology size - 1 entries.
+   */
+  void setActivations(const vector<ActivationType> &activations);
+
+  /**
+   * @brief Get the activation function of each layer.
+   * @return Activation function of each layer.
+   */
+  const vector<ActivationType> &getActivations() const { return activation_types; }
+
+  /**
+   * @brief Copy the network into another scalar type.
+   *
+   * Typically used to train in double and run inference in float, or the
+   * other way around. Optimizer state and workspaces are not copied.
+   *
+   * @tparam Other Scalar type of the copy.
+   * @return Network with the same topology, activations and hyperparameters.
+   */
+  template <typename Other> BasicNeuralNetwork<Other> cast() const
+  {
+    BasicNeuralNetwork<Other> other(topology, optimizer->getLearningRate(), optimizer->getMomentum(), activation_types);
+    other.setOptimizer(getOptimizer());
+    for(int i = 0; i < weights.size(); ++i)
+      {
+        other.weights[i] = weights[i].template cast<Other>();
+        other.biases[i]  = biases[i].template cast<Other>();
+      }
+    return other;
+  }
+
+  /**
+   * @brief Copy the topology, activations, weights and biases of another network.
+   *
+   * Buffers are reused when the topology is unchanged, the optimizer is only
+   * reset when it changes.
+   *
+   * @param source Network to copy from.
+   */
+  void copyParameters(const BasicNeuralNetwork &source);
+
+  BasicNeuralNetwork(BasicNeuralNetwork &&)            = default;
+  BasicNeuralNetwork &operator=(BasicNeuralNetwork &&) = default;
+
   /**
    * @brief Destructor.
    */
-  ~AndresNeuralNetwork();
+  ~BasicNeuralNetwork();
 };
 
+typedef BasicNeuralNetwork<double> AndresNeuralNetwork;  /**< Double precision neural network. */
+typedef BasicNeuralNetwork<float>  AndresNeuralNetworkF; /**< Single precision neural network. */
+
 #endif /* NN_H */
\ No newline at end of file
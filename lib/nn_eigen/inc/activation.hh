@@ -9,73 +9,177 @@
  *
  */
 #pragma once
+#include <cstdint>
+#include <type_traits>
 #include <Eigen/Dense>
 
 using namespace Eigen;
+
+/**
+ * @brief Identifier of an activation function, as stored in model files.
+ */
+enum class ActivationType : uint32_t
+{
+  Sigmoid   = 0, /**< Logistic sigmoid. */
+  ReLU      = 1, /**< Rectified linear unit. */
+  Tanh      = 2, /**< Hyperbolic tangent. */
+  LeakyReLU = 3, /**< Rectified linear unit with a small negative slope. */
+  Softmax   = 4, /**< Softmax over each column, output layer only. */
+};
+
+/**
+ * @brief Compile-time activation kernel.
+ *
+ * Each specialization returns Eigen array expressions, so the network can fuse
+ * the bias add, the activation and the derivative into the surrounding
+ * coefficient-wise assignment without temporaries or virtual calls.
+ *
+ * @tparam A Activation function implemented by the kernel.
+ */
+template <ActivationType A> struct ActivationKernel;
+
 /**
- * @brief Base class for activation functions.
+ * @brief Sigmoid activation function.
  */
-class ActivationFunction
+template <> struct ActivationKernel<ActivationType::Sigmoid>
 {
-  public:
   /**
    * @brief Activate function.
-   * @param x Input vector.
-   * @return Vector after activation.
+   * @param z Pre-activations.
+   * @return Expression of the activations.
    */
-  virtual VectorXd activate(const VectorXd &x) const = 0;
+  template <typename Derived> static auto activate(const ArrayBase<Derived> &z) { return (1.0 + (-z).exp()).inverse(); }
 
   /**
-   * @brief Calculate derivative of activation function.
-   * @param x Input vector.
-   * @return Vector of derivatives.
+   * @brief Derivative of sigmoid activation function.
+   * @param y Activations the derivative is evaluated at.
+   * @return Expression of the derivatives.
    */
-  virtual VectorXd derivative(const VectorXd &x) const = 0;
+  template <typename Derived> static auto derivative(const ArrayBase<Derived> &y) { return y * (1.0 - y); }
+};
 
+/**
+ * @brief ReLU activation function.
+ */
+template <> struct ActivationKernel<ActivationType::ReLU>
+{
   /**
-   * @brief Destructor.
+   * @brief Activate function.
+   * @param z Pre-activations.
+   * @return Expression of the activations.
    */
-  virtual ~ActivationFunction() {}
+  template <typename Derived> static auto activate(const ArrayBase<Derived> &z) { return z.max(0.0); }
+
+  /**
+   * @brief Derivative of ReLU activation function.
+   * @param y Activations the derivative is evaluated at.
+   * @return Expression of the derivatives.
+   */
+  template <typename Derived> static auto derivative(const ArrayBase<Derived> &y) { return (y > 0.0).template cast<typename Derived::Scalar>(); }
 };
 
 /**
- * @brief Sigmoid activation function.
+ * @brief Tanh activation function.
  */
-class SigmoidActivation : public ActivationFunction
+template <> struct ActivationKernel<ActivationType::Tanh>
 {
-  public:
   /**
    * @brief Activate function.
-   * @param x Input vector.
-   * @return Vector after activation.
+   * @param z Pre-activations.
+   * @return Expression of the activations.
    */
-  VectorXd activate(const VectorXd &x) const override;
+  template <typename Derived> static auto activate(const ArrayBase<Derived> &z) { return z.tanh(); }
 
   /**
-   * @brief Calculate derivative of sigmoid activation function.
-   * @param x Input vector.
-   * @return Vector of derivatives.
+   * @brief Derivative of tanh activation function.
+   * @param y Activations the derivative is evaluated at.
+   * @return Expression of the derivatives.
    */
-  VectorXd derivative(const VectorXd &x) const override;
+  template <typename Derived> static auto derivative(const ArrayBase<Derived> &y) { return 1.0 - y.square(); }
 };
 
 /**
- * @brief ReLU activation function.
+ * @brief Leaky ReLU activation function.
  */
-class ReLUActivation : public ActivationFunction
+template <> struct ActivationKernel<ActivationType::LeakyReLU>
 {
-  public:
+  static constexpr double slope = 0.01; /**< Slope for negative inputs. */
+
   /**
    * @brief Activate function.
-   * @param x Input vector.
-   * @return Vector after activation.
+   * @param z Pre-activations.
+   * @return Expression of the activations.
    */
-  VectorXd activate(const VectorXd &x) const override;
+  template <typename Derived> static auto activate(const ArrayBase<Derived> &z) { return z.max(slope * z); }
 
   /**
-   * @brief Calculate derivative of ReLU activation function.
-   * @param x Input vector.
-   * @return Vector of derivatives.
+   * @brief Derivative of leaky ReLU activation function.
+   * @param y Activations the derivative is evaluated at.
+   * @return Expression of the derivatives.
    */
-  VectorXd derivative(const VectorXd &x) const override;
-};
\ No newline at end of file
+  template <typename Derived> static auto derivative(const ArrayBase<Derived> &y) { return (y > 0.0).template cast<typename Derived::Scalar>() * (1.0 - slope) + slope; }
+};
+
+/**
+ * @brief Softmax activation function.
+ *
+ * Softmax couples the outputs of a column, so it is applied in place instead
+ * of returning a coefficient-wise expression. It is only allowed on the output
+ * layer, where it is paired with the cross-entropy loss: the output delta is
+ * then simply the activations minus the targets.
+ */
+template <> struct ActivationKernel<ActivationType::Softmax>
+{
+  /**
+   * @brief Normalize every column in place, shifted by its maximum for numerical stability.
+   * @param z Pre-activations on input, activations on output.
+   */
+  template <typename Derived> static void activateInPlace(MatrixBase<Derived> &z)
+  {
+    for(Index j = 0; j < z.cols(); ++j)
+      {
+        auto column    = z.col(j);
+        column.array() = (column.array() - column.maxCoeff()).exp();
+        column /= column.sum();
+      }
+  }
+};
+
+/**
+ * @brief Get the display name of an activation function.
+ * @param type Activation function.
+ * @return Name of the activation function.
+ */
+inline const char *activationName(ActivationType type)
+{
+  switch(type)
+    {
+    case ActivationType::Sigmoid: return "Sigmoid";
+    case ActivationType::ReLU: return "ReLU";
+    case ActivationType::Tanh: return "Tanh";
+    case ActivationType::LeakyReLU: return "LeakyReLU";
+    case ActivationType::Softmax: return "Softmax";
+    }
+  return "Unknown";
+}
+
+/**
+ * @brief Call a generic function with the activation kernel selected at runtime.
+ *
+ * The switch runs once per call, typically once per layer, and the function
+ * body is instantiated for every kernel.
+ *
+ * @param type Activation function to select.
+ * @param f Function taking an std::integral_constant holding the ActivationType.
+ */
+template <typename F> inline void dispatchActivation(ActivationType type, F &&f)
+{
+  switch(type)
+    {
+    case ActivationType::Sigmoid: f(std::integral_constant<ActivationType, ActivationType::Sigmoid>()); break;
+    case ActivationType::ReLU: f(std::integral_constant<ActivationType, ActivationType::ReLU>()); break;
+    case ActivationType::Tanh: f(std::integral_constant<ActivationType, ActivationType::Tanh>()); break;
+    case ActivationType::LeakyReLU: f(std::integral_constant<ActivationType, ActivationType::LeakyReLU>()); break;
+    case ActivationType::Softmax: f(std::integral_constant<ActivationType, ActivationType::Softmax>()); break;
+    }
+}
\ No newline at end of file
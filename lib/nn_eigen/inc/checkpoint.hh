@@ -0,0 +1,121 @@
+/**
+ * @file checkpoint.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the background checkpoint writer
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "snapshot.hh"
+
+/**
+ * @brief Number of checkpoint files kept by default.
+ */
+#define CHECKPOINT_KEEP 3
+
+/**
+ * @brief Writes weight snapshots to disk on a background thread.
+ *
+ * Training only hands over a snapshot and carries on, the file is written
+ * by the checkpoint thread. Each checkpoint is written to a temporary file,
+ * flushed to disk and renamed, so neither a crash nor a power loss leaves a
+ * truncated model behind. Only the
+ * last few checkpoints are kept. When the disk is slower than training, a
+ * waiting snapshot is replaced by the newer one instead of queueing up.
+ *
+ * @tparam Scalar Scalar type of the network, double or float.
+ */
+template <typename Scalar> class BasicCheckpointer
+{
+  public:
+  typedef typename BasicWeightPublisher<Scalar>::Snapshot Snapshot; /**< Weights to write. */
+
+  /**
+   * @brief Constructor, starts the checkpoint thread.
+   * @param prefix Path and name prefix of the files, the epoch and extension are appended.
+   * @param keep Number of checkpoints to keep, older ones written by this object are deleted.
+   * @param every_epochs Checkpoint every this many epochs, 0 to disable.
+   * @param every_seconds Checkpoint when this many seconds passed since the last one, 0 to disable.
+   */
+  BasicCheckpointer(const std::string &prefix, int keep = CHECKPOINT_KEEP, int every_epochs = 0, double every_seconds = 0);
+
+  BasicCheckpointer(const BasicCheckpointer &)            = delete;
+  BasicCheckpointer &operator=(const BasicCheckpointer &) = delete;
+
+  /**
+   * @brief Destructor, writes the waiting checkpoint and stops the thread.
+   */
+  ~BasicCheckpointer();
+
+  /**
+   * @brief Checkpoint at the end of an epoch if the epoch or time interval is due.
+   * @param snapshot Weights at the end of the epoch.
+   * @param epoch Number of completed epochs.
+   * @return True if a checkpoint was submitted.
+   */
+  bool epochEnded(const Snapshot &snapshot, int epoch);
+
+  /**
+   * @brief Hand a snapshot to the checkpoint thread, without waiting.
+   * @param snapshot Weights to write.
+   * @param epoch Number of completed epochs, used in the file name.
+   */
+  void submit(const Snapshot &snapshot, int epoch);
+
+  /**
+   * @brief Wait until every submitted checkpoint is written.
+   */
+  void flush();
+
+  /**
+   * @brief Get the path of the last checkpoint written.
+   * @return Path, empty if none was written yet.
+   */
+  std::string getLastPath();
+
+  private:
+  std::string                           prefix;        /**< Path and name prefix of the files. */
+  int                                   keep;          /**< Number of checkpoints to keep. */
+  int                                   every_epochs;  /**< Epoch interval, 0 to disable. */
+  double                                every_seconds; /**< Time interval, 0 to disable. */
+  std::chrono::steady_clock::time_point last_submit;   /**< Time of the last submitted checkpoint. */
+  std::deque<std::string>               files;         /**< Checkpoints written, oldest first. */
+
+  std::mutex              mutex;                 /**< Protects the hand-over state below. */
+  std::condition_variable wake_cv;               /**< Signals the thread that a snapshot is waiting. */
+  std::condition_variable idle_cv;               /**< Signals flush() that the thread is idle. */
+  Snapshot                pending;               /**< Snapshot waiting to be written. */
+  int                     pending_epoch = 0;     /**< Epoch of the waiting snapshot. */
+  bool                    writing       = false; /**< Set while a file is being written. */
+  bool                    stopping      = false; /**< Set when the checkpointer is destroyed. */
+  std::string             last_path;             /**< Path of the last checkpoint written. */
+  std::thread             writer;                /**< Checkpoint thread. */
+
+  /**
+   * @brief Body of the checkpoint thread.
+   */
+  void writerLoop();
+
+  /**
+   * @brief Write one checkpoint and delete the ones beyond keep.
+   * @param snapshot Weights to write.
+   * @param epoch Number of completed epochs.
+   */
+  void write(const Snapshot &snapshot, int epoch);
+};
+
+typedef BasicCheckpointer<double> Checkpointer;  /**< Double precision checkpointer. */
+typedef BasicCheckpointer<float>  CheckpointerF; /**< Single precision checkpointer. */
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,183 @@
+/**
+ * @file dataset.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the streaming CSV dataset
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+
+/**
+ * @brief Number of bytes read from the file at a time.
+ */
+#define DATASET_CHUNK_SIZE (1 << 20)
+
+using namespace Eigen;
+
+/**
+ * @brief Numeric CSV file parsed in chunks into one column per sample.
+ *
+ * open() counts the rows, sizes the feature and target matrices once and
+ * starts a background thread that parses the file chunk by chunk straight
+ * into them. Rows are published as they are parsed, so training can start on
+ * the first columns while the rest of the file is still being read. The
+ * matrices are the only copy of the data and are never reallocated while the
+ * file is loading.
+ *
+ * Each line holds the id columns, then the features, then the targets. The
+ * first id column is kept as the sample id, extra trailing columns are ignored.
+ *
+ * @tparam Scalar Scalar type of the matrices, double or float.
+ */
+template <typename Scalar> class BasicCsvDataset
+{
+  public:
+  typedef Eigen::Matrix<Scalar, Dynamic, Dynamic> Matrix; /**< Matrix of the dataset scalar type. */
+
+  /**
+   * @brief Constructor.
+   * @param features Number of feature columns.
+   * @param targets Number of target columns.
+   * @param id_columns Number of columns before the features, the first one is the sample id.
+   */
+  BasicCsvDataset(int features, int targets, int id_columns = 1);
+
+  BasicCsvDataset(const BasicCsvDataset &)            = delete;
+  BasicCsvDataset &operator=(const BasicCsvDataset &) = delete;
+
+  /**
+   * @brief Destructor, stops the loader thread.
+   */
+  ~BasicCsvDataset();
+
+  /**
+   * @brief Start loading a CSV file with a header line.
+   *
+   * Any load in progress is cancelled first. The call returns once the rows
+   * are counted and the matrices are sized, parsing continues in background.
+   *
+   * @param filename Name of the file to load.
+   * @return True if the file could be opened, false otherwise.
+   */
+  bool open(const std::string &filename);
+
+  /**
+   * @brief Wait for the loader thread to finish.
+   * @return True if every line was parsed, false on a parse error.
+   */
+  bool wait();
+
+  /**
+   * @brief Block until enough rows are parsed or the load ends.
+   * @param count Number of rows needed.
+   * @return Number of rows parsed, less than count only if the load ended early.
+   */
+  int waitForRows(int count);
+
+  /**
+   * @brief Get the number of rows parsed so far.
+   * @return Number of leading columns of the matrices that are valid.
+   */
+  int rowsReady() const { return rows_ready.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Get the number of data lines counted in the file.
+   *
+   * Blank lines are counted too, rowsReady() gives the final number of
+   * samples once the load is complete.
+   *
+   * @return Number of columns of the matrices.
+   */
+  int getRows() const { return rows; }
+
+  /**
+   * @brief Check whether the loader thread is done.
+   * @return True once the whole file is parsed or parsing failed.
+   */
+  bool isComplete() const { return complete.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Get the features.
+   * @return Matrix with one column per sample, valid up to rowsReady().
+   */
+  const Matrix &getFeatures() const { return features; }
+
+  /**
+   * @brief Get the targets.
+   * @return Matrix with one column per sample, valid up to rowsReady().
+   */
+  const Matrix &getTargets() const { return targets; }
+
+  /**
+   * @brief Get the sample ids.
+   * @return One id per sample, valid up to rowsReady().
+   */
+  const std::vector<int> &getIds() const { return ids; }
+
+  /**
+   * @brief Get the column names of the header line.
+   * @return Column names.
+   */
+  const std::vector<std::string> &getColumnNames() const { return column_names; }
+
+  private:
+  int                      feature_count;    /**< Number of feature columns. */
+  int                      target_count;     /**< Number of target columns. */
+  int                      id_count;         /**< Number of columns before the features. */
+  int                      rows = 0;         /**< Number of rows counted in the file. */
+  Matrix                   features;         /**< Features, one column per sample. */
+  Matrix                   targets;          /**< Targets, one column per sample. */
+  std::vector<int>         ids;              /**< Sample ids. */
+  std::vector<std::string> column_names;     /**< Column names of the header line. */
+  std::thread              loader;           /**< Background parsing thread. */
+  std::atomic<int>         rows_ready{0};    /**< Number of rows parsed so far. */
+  std::atomic<bool>        complete{true};   /**< Set when the loader thread is done. */
+  std::atomic<bool>        cancelled{false}; /**< Asks the loader thread to stop. */
+  bool                     failed = false;   /**< Set on a parse error. */
+  std::mutex               mutex;            /**< Protects the wake-up of waiting threads. */
+  std::condition_variable  ready_cv;         /**< Signals that rows were published. */
+
+  /**
+   * @brief Stop the loader thread if it is running.
+   */
+  void cancel();
+
+  /**
+   * @brief Body of the loader thread.
+   * @param filename Name of the file to parse.
+   */
+  void parse(const std::string &filename);
+
+  /**
+   * @brief Parse one data line into a column of the matrices.
+   * @param begin Start of the line.
+   * @param end End of the line, without the line break.
+   * @param row Column to fill.
+   * @return True if every needed field is a number.
+   */
+  bool parseLine(const char *begin, const char *end, int row);
+
+  /**
+   * @brief Publish the rows parsed so far to waiting threads.
+   * @param count Number of rows parsed.
+   * @param done Whether the loader thread is finishing.
+   */
+  void publish(int count, bool done);
+};
+
+typedef BasicCsvDataset<double> CsvDataset;  /**< Double precision dataset. */
+typedef BasicCsvDataset<float>  CsvDatasetF; /**< Single precision dataset. */
+
+#endif /* DATASET_H */
@@ -0,0 +1,180 @@
+/**
+ * @file model.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the binary, memory-mappable model format
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "activation.hh"
+
+#define MODEL_MAGIC     "ANNMODEL"
+#define MODEL_VERSION   2
+#define MODEL_ALIGNMENT 64
+
+using namespace Eigen;
+
+/**
+ * @brief Scalar type of the weight and bias blocks.
+ */
+enum class ModelDType : uint32_t
+{
+  Float64 = 0, /**< IEEE-754 double. */
+  Float32 = 1, /**< IEEE-754 float. */
+};
+
+/**
+ * @brief Map a scalar type to its ModelDType.
+ * @tparam Scalar double or float.
+ */
+template <typename Scalar> struct ModelDTypeOf;
+template <> struct ModelDTypeOf<double>
+{
+  static constexpr ModelDType value = ModelDType::Float64;
+};
+template <> struct ModelDTypeOf<float>
+{
+  static constexpr ModelDType value = ModelDType::Float32;
+};
+
+/**
+ * @brief Fixed 64-byte header at the start of every model file.
+ *
+ * The header is followed by the topology table (one int32 per layer), the
+ * activation table (one uint32 ActivationType per weight layer, since version
+ * 2) and by one weight block and one bias block per layer. Version 1 files
+ * have no activation table and use the header activation for every layer.
+ * Every section starts on a
+ * MODEL_ALIGNMENT boundary and blocks are stored column-major, so a mapped
+ * file can be wrapped in Eigen::Map directly. All values are little-endian.
+ */
+struct ModelHeader
+{
+  char       magic[8];       /**< Always MODEL_MAGIC, not null terminated. */
+  uint32_t   version;        /**< Format version, MODEL_VERSION when written. */
+  ModelDType dtype;          /**< Scalar type of the blocks. */
+  uint32_t   activation;     /**< ActivationType of the output layer, of every layer in version 1. */
+  uint32_t   layers;         /**< Number of entries in the topology table. */
+  uint64_t   payload_offset; /**< Offset of the first weight block. */
+  uint64_t   file_size;      /**< Size of the whole file in bytes. */
+  uint64_t   checksum;       /**< FNV-1a over the 64-bit words following the header. */
+  uint8_t    reserved[16];   /**< Zero. */
+};
+
+static_assert(sizeof(ModelHeader) == MODEL_ALIGNMENT, "model header must fill one alignment unit");
+
+/**
+ * @brief Read-only, memory-mapped view of a model file.
+ *
+ * Weight and bias blocks are exposed as Eigen::Map over the mapping, so no
+ * value is parsed or copied until the caller decides to.
+ */
+class ModelFile
+{
+  public:
+  template <typename Scalar> using ConstMatrixMap = Map<const Matrix<Scalar, Dynamic, Dynamic>, Aligned64>; /**< View of a weight block. */
+  template <typename Scalar> using ConstVectorMap = Map<const Matrix<Scalar, Dynamic, 1>, Aligned64>;       /**< View of a bias block. */
+
+  /**
+   * @brief Constructor.
+   */
+  ModelFile() = default;
+
+  ModelFile(const ModelFile &)            = delete;
+  ModelFile &operator=(const ModelFile &) = delete;
+
+  /**
+   * @brief Destructor, unmaps the file.
+   */
+  ~ModelFile();
+
+  /**
+   * @brief Map a model file and validate its header, layout and checksum.
+   * @param filename Name of the file to map.
+   * @return True if the file is a valid model, false otherwise.
+   */
+  bool open(const std::string &filename);
+
+  /**
+   * @brief Unmap the file.
+   */
+  void close();
+
+  /**
+   * @brief Check whether a file starts with the model magic.
+   * @param filename Name of the file to check.
+   * @return True if the file looks like a binary model.
+   */
+  static bool isModelFile(const std::string &filename);
+
+  /**
+   * @brief Write a model file.
+   *
+   * The blocks are stored in the scalar type of the matrices.
+   *
+   * @tparam Scalar double or float.
+   * @param filename Name of the file to write.
+   * @param topology Topology of the network.
+   * @param activations Activation function of each layer.
+   * @param weights Weight matrices, one per layer.
+   * @param biases Bias vectors, one per layer.
+   * @return True if the file was written completely.
+   */
+  template <typename Scalar> static bool write(const std::string &filename, const std::vector<int> &topology, const std::vector<ActivationType> &activations, const std::vector<Matrix<Scalar, Dynamic, Dynamic>> &weights, const std::vector<Matrix<Scalar, Dynamic, 1>> &biases);
+
+  /**
+   * @brief Get the topology stored in the file.
+   * @return Vector representing the topology.
+   */
+  const std::vector<int> &getTopology() const { return topology; }
+
+  /**
+   * @brief Get the activation functions stored in the file.
+   * @return Activation function of each layer.
+   */
+  const std::vector<ActivationType> &getActivations() const { return activations; }
+
+  /**
+   * @brief Get the scalar type of the blocks.
+   * @return Scalar type stored in the file.
+   */
+  ModelDType getDType() const { return dtype; }
+
+  /**
+   * @brief Get a view of the weights of a layer.
+   * @tparam Scalar Scalar type of the file, see getDType().
+   * @param layer Index of the layer, from 0 to topology size - 2.
+   * @return Map over the mapped weight block.
+   */
+  template <typename Scalar> ConstMatrixMap<Scalar> weights(int layer) const;
+
+  /**
+   * @brief Get a view of the biases of a layer.
+   * @tparam Scalar Scalar type of the file, see getDType().
+   * @param layer Index of the layer, from 0 to topology size - 2.
+   * @return Map over the mapped bias block.
+   */
+  template <typename Scalar> ConstVectorMap<Scalar> biases(int layer) const;
+
+  private:
+  const unsigned char        *data        = nullptr;             /**< Start of the mapping. */
+  size_t                      size        = 0;                   /**< Size of the mapping in bytes. */
+  void                       *file_handle = nullptr;             /**< Platform file handle, used on Windows only. */
+  void                       *map_handle  = nullptr;             /**< Platform mapping handle, used on Windows only. */
+  std::vector<int>            topology;                          /**< Topology read from the file. */
+  std::vector<ActivationType> activations;                       /**< Activation of each layer read from the file. */
+  std::vector<size_t>         weight_offsets;                    /**< Offset of each weight block. */
+  std::vector<size_t>         bias_offsets;                      /**< Offset of each bias block. */
+  ModelDType                  dtype       = ModelDType::Float64; /**< Scalar type of the blocks. */
+};
+
+#endif /* MODEL_H */
@@ -0,0 +1,235 @@
+/**
+ * @file optimizer.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the gradient descent optimizers
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+
+#define OPTIMIZER_RMSPROP_DECAY 0.9
+#define OPTIMIZER_ADAM_BETA1    0.9
+#define OPTIMIZER_ADAM_BETA2    0.999
+#define OPTIMIZER_EPSILON       1e-8
+
+using namespace Eigen;
+
+/**
+ * @brief Enumeration of the available optimizers.
+ */
+enum class OptimizerType : uint32_t
+{
+  SGD      = 0, /**< Gradient descent with classical momentum. */
+  Nesterov = 1, /**< Gradient descent with Nesterov momentum. */
+  RMSProp  = 2, /**< Step scaled by a running average of the squared gradient. */
+  Adam     = 3, /**< Bias-corrected running averages of the gradient and its square. */
+};
+
+/**
+ * @brief Get the display name of an optimizer.
+ * @param type Optimizer.
+ * @return Name of the optimizer.
+ */
+inline const char *optimizerName(OptimizerType type)
+{
+  switch(type)
+    {
+    case OptimizerType::SGD: return "SGD";
+    case OptimizerType::Nesterov: return "Nesterov";
+    case OptimizerType::RMSProp: return "RMSProp";
+    case OptimizerType::Adam: return "Adam";
+    }
+  return "Unknown";
+}
+
+/**
+ * @brief Updates the weights and biases of a network from summed gradients.
+ *
+ * The state buffers are allocated once per topology by reset(), so step()
+ * only runs coefficient-wise Eigen expressions in place. Gradients are
+ * averaged over the batch so the learning rate does not depend on its size.
+ * The learning rate and momentum are atomic, another thread may change them
+ * while step() runs, it reads each of them once.
+ *
+ * @tparam Scalar Scalar type of the network, double or float.
+ */
+template <typename Scalar> class BasicOptimizer
+{
+  public:
+  typedef Eigen::Matrix<Scalar, Dynamic, Dynamic> Matrix; /**< Matrix of the network scalar type. */
+  typedef Eigen::Matrix<Scalar, Dynamic, 1>       Vector; /**< Column vector of the network scalar type. */
+
+  /**
+   * @brief Constructor.
+   * @param learning_rate Learning rate.
+   * @param momentum Momentum, used by SGD and Nesterov.
+   */
+  BasicOptimizer(double learning_rate, double momentum) : learning_rate(learning_rate), momentum(momentum) {}
+
+  /**
+   * @brief Destructor.
+   */
+  virtual ~BasicOptimizer() = default;
+
+  /**
+   * @brief Create an optimizer.
+   * @param type Optimizer to create.
+   * @param learning_rate Learning rate.
+   * @param momentum Momentum, used by SGD and Nesterov.
+   * @return The optimizer, its state is allocated by reset().
+   */
+  static std::unique_ptr<BasicOptimizer> create(OptimizerType type, double learning_rate, double momentum);
+
+  /**
+   * @brief Get the type of the optimizer.
+   * @return Optimizer type.
+   */
+  virtual OptimizerType getType() const = 0;
+
+  /**
+   * @brief Allocate and zero the state for a topology.
+   * @param topology Topology of the network.
+   */
+  virtual void reset(const std::vector<int> &topology) = 0;
+
+  /**
+   * @brief Apply one update.
+   * @param weights Weights of the network, updated in place.
+   * @param biases Biases of the network, updated in place.
+   * @param weight_gradients Weight gradients summed over the batch.
+   * @param bias_gradients Bias gradients summed over the batch.
+   * @param samples Number of samples the gradients were summed over.
+   */
+  virtual void step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples) = 0;
+
+  /**
+   * @brief Set the learning rate.
+   * @param eta Learning rate value.
+   */
+  void setLearningRate(double eta) { learning_rate.store(eta, std::memory_order_relaxed); }
+
+  /**
+   * @brief Set the momentum.
+   * @param alpha Momentum value.
+   */
+  void setMomentum(double alpha) { momentum.store(alpha, std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the learning rate.
+   * @return Learning rate value.
+   */
+  double getLearningRate() const { return learning_rate.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Get the momentum.
+   * @return Momentum value.
+   */
+  double getMomentum() const { return momentum.load(std::memory_order_relaxed); }
+
+  protected:
+  std::atomic<double> learning_rate; /**< Learning rate. */
+  std::atomic<double> momentum;      /**< Momentum, used by SGD and Nesterov. */
+
+  /**
+   * @brief Size one state buffer per layer and zero it.
+   * @param topology Topology of the network.
+   * @param weight_state Filled with one zero matrix per weight matrix.
+   * @param bias_state Filled with one zero vector per bias vector.
+   */
+  static void allocate(const std::vector<int> &topology, std::vector<Matrix> &weight_state, std::vector<Vector> &bias_state);
+};
+
+/**
+ * @brief Gradient descent with classical momentum on weights and biases.
+ */
+template <typename Scalar> class SGDOptimizer : public BasicOptimizer<Scalar>
+{
+  public:
+  typedef typename BasicOptimizer<Scalar>::Matrix Matrix;
+  typedef typename BasicOptimizer<Scalar>::Vector Vector;
+
+  using BasicOptimizer<Scalar>::BasicOptimizer;
+
+  OptimizerType getType() const override { return OptimizerType::SGD; }
+  void          reset(const std::vector<int> &topology) override;
+  void          step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples) override;
+
+  private:
+  std::vector<Matrix> weight_velocity; /**< Velocity of each weight matrix. */
+  std::vector<Vector> bias_velocity;   /**< Velocity of each bias vector. */
+};
+
+/**
+ * @brief Gradient descent with Nesterov momentum on weights and biases.
+ */
+template <typename Scalar> class NesterovOptimizer : public BasicOptimizer<Scalar>
+{
+  public:
+  typedef typename BasicOptimizer<Scalar>::Matrix Matrix;
+  typedef typename BasicOptimizer<Scalar>::Vector Vector;
+
+  using BasicOptimizer<Scalar>::BasicOptimizer;
+
+  OptimizerType getType() const override { return OptimizerType::Nesterov; }
+  void          reset(const std::vector<int> &topology) override;
+  void          step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples) override;
+
+  private:
+  std::vector<Matrix> weight_velocity; /**< Velocity of each weight matrix. */
+  std::vector<Vector> bias_velocity;   /**< Velocity of each bias vector. */
+};
+
+/**
+ * @brief RMSProp, decaying with OPTIMIZER_RMSPROP_DECAY.
+ */
+template <typename Scalar> class RMSPropOptimizer : public BasicOptimizer<Scalar>
+{
+  public:
+  typedef typename BasicOptimizer<Scalar>::Matrix Matrix;
+  typedef typename BasicOptimizer<Scalar>::Vector Vector;
+
+  using BasicOptimizer<Scalar>::BasicOptimizer;
+
+  OptimizerType getType() const override { return OptimizerType::RMSProp; }
+  void          reset(const std::vector<int> &topology) override;
+  void          step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples) override;
+
+  private:
+  std::vector<Matrix> weight_square; /**< Running average of the squared weight gradients. */
+  std::vector<Vector> bias_square;   /**< Running average of the squared bias gradients. */
+};
+
+/**
+ * @brief Adam, with OPTIMIZER_ADAM_BETA1 and OPTIMIZER_ADAM_BETA2.
+ */
+template <typename Scalar> class AdamOptimizer : public BasicOptimizer<Scalar>
+{
+  public:
+  typedef typename BasicOptimizer<Scalar>::Matrix Matrix;
+  typedef typename BasicOptimizer<Scalar>::Vector Vector;
+
+  using BasicOptimizer<Scalar>::BasicOptimizer;
+
+  OptimizerType getType() const override { return OptimizerType::Adam; }
+  void          reset(const std::vector<int> &topology) override;
+  void          step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples) override;
+
+  private:
+  std::vector<Matrix> weight_mean;   /**< Running average of the weight gradients. */
+  std::vector<Vector> bias_mean;     /**< Running average of the bias gradients. */
+  std::vector<Matrix> weight_square; /**< Running average of the squared weight gradients. */
+  std::vector<Vector> bias_square;   /**< Running average of the squared bias gradients. */
+  long                steps = 0;     /**< Number of updates since the last reset, for bias correction. */
+};
+
+#endif /* OPTIMIZER_H */
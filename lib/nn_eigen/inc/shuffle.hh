@@ -0,0 +1,95 @@
+/**
+ * @file shuffle.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the shuffled mini-batch gatherer
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+/**
+ * @brief Visits the samples of a dataset in a new random order every epoch.
+ *
+ * Only a permutation of 32-bit sample indices is shuffled, the dataset is
+ * never moved. Each batch is gathered from its columns into buffers that
+ * keep their allocation from one batch to the next, so the trainer still
+ * reads contiguous columns and nothing is allocated per batch. The outputs
+ * of a batch are scattered back to the rows they belong to.
+ *
+ * @tparam Scalar Scalar type of the matrices, double or float.
+ */
+template <typename Scalar> class BasicBatchShuffler
+{
+  public:
+  typedef Eigen::Matrix<Scalar, Dynamic, Dynamic> Matrix; /**< Matrix of the dataset scalar type. */
+
+  /**
+   * @brief Constructor.
+   * @param seed Seed of the permutations, a random one by default.
+   */
+  explicit BasicBatchShuffler(unsigned seed = std::random_device{}());
+
+  /**
+   * @brief Draw a new order of the samples, to be called at the start of an epoch.
+   * @param rows Number of samples, the leading columns of the dataset.
+   */
+  void shuffle(int rows);
+
+  /**
+   * @brief Get the number of samples in the current order.
+   * @return Number of samples of the last shuffle().
+   */
+  int size() const { return order.size(); }
+
+  /**
+   * @brief Copy the columns of a batch into the batch buffers.
+   * @param features Features of the whole dataset, one column per sample.
+   * @param targets Targets of the whole dataset, one column per sample.
+   * @param first Position of the batch in the current order.
+   * @param count Number of samples in the batch.
+   */
+  void gather(const Ref<const Matrix> &features, const Ref<const Matrix> &targets, int first, int count);
+
+  /**
+   * @brief Get the features of the last gathered batch.
+   * @return View of the batch buffer, valid until the next gather().
+   */
+  Ref<const Matrix> getInputs() const { return inputs.leftCols(count); }
+
+  /**
+   * @brief Get the targets of the last gathered batch.
+   * @return View of the batch buffer, valid until the next gather().
+   */
+  Ref<const Matrix> getTargets() const { return targets.leftCols(count); }
+
+  /**
+   * @brief Copy the outputs of the last gathered batch back to the columns of their samples.
+   * @param results Outputs of the batch, one column per sample in batch order.
+   * @param outputs Outputs of the whole dataset.
+   */
+  void scatter(const Ref<const Matrix> &results, Ref<Matrix> outputs) const;
+
+  private:
+  std::vector<uint32_t> order;     /**< Sample indices in the current order. */
+  std::mt19937          generator; /**< Source of the permutations. */
+  Matrix                inputs;    /**< Features of the batch, reused between batches. */
+  Matrix                targets;   /**< Targets of the batch, reused between batches. */
+  int                   first = 0; /**< Position of the last gathered batch in the order. */
+  int                   count = 0; /**< Number of samples in the last gathered batch. */
+};
+
+typedef BasicBatchShuffler<double> BatchShuffler;  /**< Double precision shuffler. */
+typedef BasicBatchShuffler<float>  BatchShufflerF; /**< Single precision shuffler. */
+
+#endif /* SHUFFLE_H */
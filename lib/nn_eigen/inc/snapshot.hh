@@ -0,0 +1,71 @@
+/**
+ * @file snapshot.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the weight snapshot publisher
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "NN.hh"
+
+/**
+ * @brief Publishes immutable copies of a network being trained.
+ *
+ * The training thread calls publish() at batch boundaries. Any other thread
+ * gets the latest copy with latest() and keeps it alive for as long as it
+ * holds the pointer, so it can save or score it while training goes on. It
+ * never waits for the trainer, and the trainer never waits for it: publishing
+ * swaps a shared pointer, and a copy is freed by whoever drops it last.
+ *
+ * Copies no reader holds any more are reused by the next publish(), so the
+ * steady state only copies weights, without allocating.
+ *
+ * @tparam Scalar Scalar type of the network, double or float.
+ */
+template <typename Scalar> class BasicWeightPublisher
+{
+  public:
+  typedef BasicNeuralNetwork<Scalar>     Network;  /**< Type of the published network. */
+  typedef std::shared_ptr<const Network> Snapshot; /**< Read-only copy shared with readers. */
+
+  /**
+   * @brief Publish a copy of a network, to be called by a single writer thread.
+   * @param network Network to copy, it is not modified.
+   */
+  void publish(const Network &network);
+
+  /**
+   * @brief Get the latest published copy.
+   * @return The copy, nullptr if nothing was published since the last clear().
+   */
+  Snapshot latest() const { return std::atomic_load_explicit(&current, std::memory_order_acquire); }
+
+  /**
+   * @brief Get the number of copies published so far.
+   * @return Version of the latest copy.
+   */
+  unsigned long getVersion() const { return version.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Drop the latest copy, for when the network is replaced.
+   */
+  void clear() { std::atomic_store_explicit(&current, Snapshot(), std::memory_order_release); }
+
+  private:
+  Snapshot                              current;    /**< Latest copy, only accessed atomically. */
+  std::vector<std::shared_ptr<Network>> published;  /**< Every copy made, owned by the writer for reuse. */
+  std::atomic<unsigned long>            version{0}; /**< Number of copies published. */
+};
+
+typedef BasicWeightPublisher<double> WeightPublisher;  /**< Double precision publisher. */
+typedef BasicWeightPublisher<float>  WeightPublisherF; /**< Single precision publisher. */
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,116 @@
+/**
+ * @file trainer.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the data-parallel trainer
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NN.hh"
+
+/**
+ * @brief Smallest number of samples worth handing to a thread.
+ */
+#define TRAINER_MIN_SLICE 8
+
+/**
+ * @brief Trains a BasicNeuralNetwork by splitting every batch across threads.
+ *
+ * Each thread owns a replica of the activation, delta and gradient
+ * workspaces and runs the forward and backward pass for its slice of the
+ * batch against the shared weights. The per-thread gradients are summed and
+ * the network applies a single update for the whole batch, so the result is
+ * the same as a single-threaded pass over the batch.
+ *
+ * @tparam Scalar Scalar type of the network, double or float.
+ */
+template <typename Scalar> class BasicParallelTrainer
+{
+  public:
+  typedef BasicNeuralNetwork<Scalar> Network; /**< Type of the trained network. */
+  typedef typename Network::Matrix   Matrix;  /**< Matrix of the network scalar type. */
+
+  /**
+   * @brief Constructor, starts the worker threads.
+   * @param network Network to train, it must outlive the trainer.
+   * @param threads Number of threads, the calling thread included.
+   */
+  BasicParallelTrainer(Network &network, int threads);
+
+  BasicParallelTrainer(const BasicParallelTrainer &)            = delete;
+  BasicParallelTrainer &operator=(const BasicParallelTrainer &) = delete;
+
+  /**
+   * @brief Destructor, stops the worker threads.
+   */
+  ~BasicParallelTrainer();
+
+  /**
+   * @brief Size every workspace for a batch width.
+   * @param capacity Largest number of samples per batch.
+   */
+  void reserveBatch(int capacity);
+
+  /**
+   * @brief Run one forward and backward pass over a batch and update the network once.
+   * @param inputs Input matrix, one column per sample.
+   * @param targets Target matrix, one column per sample.
+   */
+  void trainBatch(const Ref<const Matrix> &inputs, const Ref<const Matrix> &targets);
+
+  /**
+   * @brief Get the outputs of the last batch.
+   * @return View of the outputs, one column per sample. It stays valid until the next batch.
+   */
+  Ref<const Matrix> getResults() const;
+
+  /**
+   * @brief Get the number of threads.
+   * @return Number of threads, the calling thread included.
+   */
+  int getThreads() const { return workspaces.size(); }
+
+  private:
+  Network                                 &network;    /**< Network being trained. */
+  std::vector<typename Network::Workspace> workspaces; /**< One workspace per thread. */
+  std::vector<std::thread>                 workers;    /**< Worker threads, the calling thread is thread 0. */
+  Matrix                                   outputs;    /**< Outputs of the last batch. */
+  int                                      cols = 0;   /**< Number of samples in the last batch. */
+
+  const Ref<const Matrix> *batch_inputs  = nullptr; /**< Inputs of the batch being trained. */
+  const Ref<const Matrix> *batch_targets = nullptr; /**< Targets of the batch being trained. */
+  int                      active        = 0;       /**< Number of threads working on the batch. */
+
+  std::mutex              mutex;              /**< Protects the dispatch state below. */
+  std::condition_variable start_cv;           /**< Signals workers that a batch is ready. */
+  std::condition_variable done_cv;            /**< Signals the caller that workers are done. */
+  unsigned long           generation = 0;     /**< Incremented for every batch. */
+  int                     pending    = 0;     /**< Workers that have not finished the batch. */
+  bool                    stopping   = false; /**< Set when the trainer is destroyed. */
+
+  /**
+   * @brief Forward and backward pass of one thread's slice of the batch.
+   * @param index Thread index.
+   */
+  void trainSlice(int index);
+
+  /**
+   * @brief Main loop of a worker thread.
+   * @param index Thread index.
+   */
+  void workerLoop(int index);
+};
+
+typedef BasicParallelTrainer<double> ParallelTrainer;  /**< Trainer of AndresNeuralNetwork. */
+typedef BasicParallelTrainer<float>  ParallelTrainerF; /**< Trainer of AndresNeuralNetworkF. */
+
+#endif /* TRAINER_H */
@@ -0,0 +1,148 @@
+/**
+ * @file validation.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Header of the validation pass and early stopping
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <thread>
+#include "snapshot.hh"
+
+/**
+ * @brief Default percentage of the samples held out for validation.
+ */
+#define VALIDATION_PERCENT 20
+
+/**
+ * @brief Default number of epochs without improvement before training stops.
+ */
+#define VALIDATION_PATIENCE 10
+
+/**
+ * @brief Score of a network on the validation samples.
+ */
+struct ValidationResult
+{
+  int    epoch    = 0;   /**< Number of completed epochs of the scored weights, 0 if none. */
+  double error    = 0.0; /**< Mean over the samples of the squared error. */
+  double accuracy = 0.0; /**< Percentage of samples whose thresholded outputs all match the targets. */
+};
+
+/**
+ * @brief Scores weight snapshots on held-out samples and decides when to stop.
+ *
+ * start() scores a snapshot on a background thread, split across worker
+ * threads with the const predict(), so the pass overlaps the next epoch of
+ * training. finish() waits for it and updates the early stopping state: the
+ * snapshot with the lowest validation error is kept, and training should stop
+ * once the target accuracy is reached or the error has not improved for
+ * patience epochs. Holding the best snapshot keeps the publisher from reusing
+ * it, so it can be restored with copyParameters() at the end of the run.
+ *
+ * @tparam Scalar Scalar type of the network, double or float.
+ */
+template <typename Scalar> class BasicValidator
+{
+  public:
+  typedef BasicNeuralNetwork<Scalar>                      Network;  /**< Type of the scored network. */
+  typedef typename Network::Matrix                        Matrix;   /**< Matrix of the network scalar type. */
+  typedef typename BasicWeightPublisher<Scalar>::Snapshot Snapshot; /**< Weights to score. */
+
+  /**
+   * @brief Constructor.
+   * @param threads Number of threads scoring a snapshot.
+   * @param threshold Output threshold of the accuracy.
+   * @param patience Epochs without improvement before stopping, 0 to disable.
+   * @param target_accuracy Validation accuracy in percent at which to stop, 0 to disable.
+   */
+  BasicValidator(int threads, double threshold = 0.5, int patience = VALIDATION_PATIENCE, double target_accuracy = 0);
+
+  BasicValidator(const BasicValidator &)            = delete;
+  BasicValidator &operator=(const BasicValidator &) = delete;
+
+  /**
+   * @brief Destructor, waits for the pass in progress.
+   */
+  ~BasicValidator();
+
+  /**
+   * @brief Start scoring a snapshot in background.
+   *
+   * A pass still in progress is finished first. The inputs and targets are
+   * read by the background thread, they must stay valid until finish().
+   *
+   * @param snapshot Weights to score.
+   * @param inputs Validation inputs, one column per sample.
+   * @param targets Validation targets, one column per sample.
+   * @param epoch Number of completed epochs of the snapshot.
+   */
+  void start(const Snapshot &snapshot, const Ref<const Matrix> &inputs, const Ref<const Matrix> &targets, int epoch);
+
+  /**
+   * @brief Wait for the pass in progress and update the early stopping state.
+   * @return True if training should stop.
+   */
+  bool finish();
+
+  /**
+   * @brief Check whether training should stop.
+   * @return True once the target accuracy is reached or patience ran out.
+   */
+  bool shouldStop() const { return stop; }
+
+  /**
+   * @brief Get the score of the last finished pass.
+   * @return Score, epoch 0 if no pass finished.
+   */
+  const ValidationResult &getLast() const { return last; }
+
+  /**
+   * @brief Get the score of the best snapshot.
+   * @return Score, epoch 0 if no pass finished.
+   */
+  const ValidationResult &getBest() const { return best; }
+
+  /**
+   * @brief Get the snapshot with the lowest validation error.
+   * @return Snapshot, nullptr if no pass finished.
+   */
+  const Snapshot &getBestSnapshot() const { return best_snapshot; }
+
+  /**
+   * @brief Get the outputs of the last finished pass.
+   * @return View of the outputs, one column per validation sample.
+   */
+  Ref<const Matrix> getOutputs() const { return outputs; }
+
+  private:
+  int              threads;         /**< Number of threads scoring a snapshot. */
+  double           threshold;       /**< Output threshold of the accuracy. */
+  int              patience;        /**< Epochs without improvement before stopping. */
+  double           target_accuracy; /**< Validation accuracy at which to stop. */
+  std::thread      evaluator;       /**< Background pass in progress. */
+  Snapshot         scored;          /**< Snapshot of the pass in progress. */
+  Snapshot         best_snapshot;   /**< Snapshot with the lowest validation error. */
+  Matrix           outputs;         /**< Outputs of the last pass. */
+  ValidationResult running;         /**< Score of the pass in progress. */
+  ValidationResult last;            /**< Score of the last finished pass. */
+  ValidationResult best;            /**< Score of the best snapshot. */
+  bool             stop = false;    /**< Set when training should stop. */
+
+  /**
+   * @brief Score the snapshot of the pass in progress, run by the background thread.
+   * @param inputs Validation inputs.
+   * @param targets Validation targets.
+   */
+  void evaluate(const Ref<const Matrix> &inputs, const Ref<const Matrix> &targets);
+};
+
+typedef BasicValidator<double> Validator;  /**< Double precision validator. */
+typedef BasicValidator<float>  ValidatorF; /**< Single precision validator. */
+
+#endif /* VALIDATION_H */
@@ -10,39 +10,76 @@
  */
 
 #include "NN.hh"
+#include "model.hh"
+#include <algorithm>
+#include <stdexcept>
 
-AndresNeuralNetwork::AndresNeuralNetwork(const vector<int> &topology, double learning_rate, double momentum, ActivationFunction *activation_function) : topology(topology), learning_rate(learning_rate), momentum(momentum), activation_function(activation_function) { setTopology(topology); }
+template <typename Scalar> BasicNeuralNetwork<Scalar>::BasicNeuralNetwork(const vector<int> &topology, double learning_rate, double momentum, ActivationType activation) : topology(topology), optimizer(BasicOptimizer<Scalar>::create(OptimizerType::SGD, learning_rate, momentum))
+{
+  // softmax only applies to the output layer, the hidden layers fall back to the sigmoid as in setTopology()
+  vector<ActivationType> activations(topology.size() - 1, activation == ActivationType::Softmax ? ActivationType::Sigmoid : activation);
+  if(!activations.empty()) activations.back() = activation;
+  setTopology(topology);
+  setActivations(activations);
+}
+
+template <typename Scalar> BasicNeuralNetwork<Scalar>::BasicNeuralNetwork(const vector<int> &topology, double learning_rate, double momentum, const vector<ActivationType> &activations) : topology(topology), optimizer(BasicOptimizer<Scalar>::create(OptimizerType::SGD, learning_rate, momentum))
+{
+  setTopology(topology);
+  setActivations(activations);
+}
 
-AndresNeuralNetwork::~AndresNeuralNetwork() {}
+template <typename Scalar> BasicNeuralNetwork<Scalar>::~BasicNeuralNetwork() {}
 
-void AndresNeuralNetwork::backpropagation(const VectorXd &target)
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::backpropagation(const Ref<const Matrix> &targets)
 {
-  deltas.clear();
-  VectorXd output_error = activations.back() - target;
-  VectorXd output_delta = output_error.array() * activation_function->derivative(activations.back()).array();
-  deltas.push_back(output_delta);
+  computeGradients(targets, workspace);
+  applyGradients(workspace.weight_gradients, workspace.bias_gradients, workspace.cols);
+}
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::computeGradients(const Ref<const Matrix> &targets, Workspace &ws) const
+{
+  if(ws.cols == 0 || targets.cols() != ws.cols) { throw std::logic_error("Targets do not match the last forward pass"); }
+  if(ws.deltas.size() != weights.size()) { throw std::logic_error("Workspace was reserved for inference only"); }
+
+  const int n = ws.cols;
+  const int L = weights.size();
+
+  // output error and derivative in a single pass
+  auto output = ws.activations[L].leftCols(n).array();
+  dispatchActivation(activation_types[L - 1], [&](auto kind) {
+    typedef ActivationKernel<decltype(kind)::value> Kernel;
+
+    // softmax paired with cross-entropy reduces to the plain error
+    if constexpr(decltype(kind)::value == ActivationType::Softmax) { ws.deltas[L - 1].leftCols(n).array() = output - targets.array(); }
+    else { ws.deltas[L - 1].leftCols(n).array() = (output - targets.array()) * Kernel::derivative(output); }
+  });
 
-  for(int i = weights.size() - 1; i > 0; --i)
+  for(int i = L - 1; i > 0; --i)
     {
-      VectorXd error = weights[i].transpose() * deltas.back();
-      VectorXd delta = error.array() * activation_function->derivative(activations[i]).array();
-      deltas.push_back(delta);
-    }
+      auto delta = ws.deltas[i - 1].leftCols(n);
+      delta.noalias() = weights[i].transpose() * ws.deltas[i].leftCols(n);
 
-  reverse(deltas.begin(), deltas.end());
+      dispatchActivation(activation_types[i - 1], [&](auto kind) {
+        typedef ActivationKernel<decltype(kind)::value> Kernel;
 
-  for(int i = 0; i < weights.size(); ++i)
+        // setActivations keeps softmax out of the hidden layers
+        if constexpr(decltype(kind)::value != ActivationType::Softmax) { delta.array() *= Kernel::derivative(ws.activations[i].leftCols(n).array()); }
+      });
+    }
+
+  for(int i = 0; i < L; ++i)
     {
-      MatrixXd weight_update = learning_rate * (deltas[i] * activations[i].transpose());
-      weights[i] -= weight_update + momentum * prev_weight_update[i];
-      biases[i] -= learning_rate * deltas[i];
-      prev_weight_update[i] = weight_update;
+      ws.weight_gradients[i].noalias() = ws.deltas[i].leftCols(n) * ws.activations[i].leftCols(n).transpose();
+      ws.bias_gradients[i]             = ws.deltas[i].leftCols(n).rowwise().sum();
     }
 }
 
-VectorXd AndresNeuralNetwork::getResults(std::function<void(string)> log) const
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::applyGradients(const vector<Matrix> &weight_gradients, const vector<Vector> &bias_gradients, int samples) { optimizer->step(weights, biases, weight_gradients, bias_gradients, samples); }
+
+template <typename Scalar> Ref<const typename BasicNeuralNetwork<Scalar>::Matrix> BasicNeuralNetwork<Scalar>::getResults(std::function<void(string)> log) const
 {
-  if(activations.size() > 1)
+  if(workspace.cols > 0)
     {
       if(log != nullptr)
         {
@@ -50,41 +87,115 @@ VectorXd AndresNeuralNetwork::getResults(std::function<void(string)> log) const
           stringstream message;
 
           message << "OUTPUT: " << endl;
-          message << activations.back().format(CleanFmt) << endl;
+          message << workspace.activations.back().leftCols(workspace.cols).format(CleanFmt) << endl;
 
           log(message.str());
         }
-      return activations.back();
+      return workspace.activations.back().leftCols(workspace.cols);
     }
   else { throw std::logic_error("Output layer activations not computed"); }
 }
 
-std::vector<int> AndresNeuralNetwork::getTopology() const { return topology; }
+template <typename Scalar> std::vector<int> BasicNeuralNetwork<Scalar>::getTopology() const { return topology; }
 
-void AndresNeuralNetwork::forwardPropagation(const VectorXd &input, std::function<void(string)> log)
+template <typename Scalar> Ref<const typename BasicNeuralNetwork<Scalar>::Matrix> BasicNeuralNetwork<Scalar>::predict(const Ref<const Matrix> &inputs, Workspace &ws) const
 {
-  activations.clear();
-  activations.push_back(input);
+  if(ws.activations.empty()) { reserveWorkspace(ws, inputs.cols(), false); }
+  forwardPropagation(inputs, ws);
+  return ws.activations.back().leftCols(ws.cols);
+}
 
+template <typename Scalar> Ref<const typename BasicNeuralNetwork<Scalar>::Matrix> BasicNeuralNetwork<Scalar>::predict(const Ref<const Matrix> &inputs) const
+{
+  // one scratch workspace per thread, shared by every network of this scalar type
+  static thread_local Workspace ws;
+  return predict(inputs, ws);
+}
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::predict(const Ref<const Matrix> &inputs, Ref<Matrix> outputs) const
+{
+  if(outputs.rows() != topology.back() || outputs.cols() != inputs.cols()) { throw std::invalid_argument("Outputs do not match the inputs and the output layer"); }
+  for(int start = 0; start < inputs.cols(); start += NN_PREDICT_BATCH)
+    {
+      int count                        = std::min<int>(NN_PREDICT_BATCH, inputs.cols() - start);
+      outputs.middleCols(start, count) = predict(inputs.middleCols(start, count));
+    }
+}
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::forwardPropagation(const Ref<const Matrix> &inputs, std::function<void(string)> log)
+{
   if(log != nullptr)
     {
       IOFormat     CleanFmt(4, 0, ", ", "\n", "[", "]");
       stringstream message;
 
       message << "Input: " << endl;
-      message << input.format(CleanFmt) << endl;
+      message << inputs.format(CleanFmt) << endl;
 
       log(message.str());
     }
 
+  forwardPropagation(inputs, workspace);
+}
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::forwardPropagation(const Ref<const Matrix> &inputs, Workspace &ws) const
+{
+  // a workspace last sized for another network or a narrower batch is resized, keeping its kind
+  bool fits = inputs.cols() <= ws.capacity && ws.activations.size() == topology.size();
+  for(int i = 0; fits && i < topology.size(); ++i) fits = ws.activations[i].rows() == topology[i];
+  if(!fits) { reserveWorkspace(ws, std::max<int>(inputs.cols(), ws.capacity), ws.activations.empty() || !ws.deltas.empty()); }
+
+  const int n = inputs.cols();
+  ws.cols     = n;
+  ws.activations[0].leftCols(n) = inputs;
+
   for(int i = 0; i < weights.size(); ++i)
     {
-      VectorXd layer_output = weights[i] * activations.back() + biases[i];
-      activations.push_back(activation_function->activate(layer_output));
+      // GEMM into the workspace, then bias add and activation in a single pass
+      auto layer_output = ws.activations[i + 1].leftCols(n);
+      layer_output.noalias() = weights[i] * ws.activations[i].leftCols(n);
+
+      dispatchActivation(activation_types[i], [&](auto kind) {
+        typedef ActivationKernel<decltype(kind)::value> Kernel;
+
+        if constexpr(decltype(kind)::value == ActivationType::Softmax)
+          {
+            layer_output.colwise() += biases[i];
+            Kernel::activateInPlace(layer_output);
+          }
+        else { layer_output.array() = Kernel::activate((layer_output.colwise() + biases[i]).array()); }
+      });
     }
 }
 
-bool AndresNeuralNetwork::loadWeights(const std::string &filename)
+template <typename Scalar> bool BasicNeuralNetwork<Scalar>::loadWeights(const std::string &filename)
+{
+  if(!ModelFile::isModelFile(filename)) { return loadLegacyWeights(filename); }
+
+  ModelFile model;
+  if(!model.open(filename)) { return false; }
+
+  topology         = model.getTopology();
+  activation_types = model.getActivations();
+  allocateLayers();
+  // a file saved in the other precision is converted while copying
+  for(int i = 0; i < weights.size(); ++i)
+    {
+      if(model.getDType() == ModelDType::Float32)
+        {
+          weights[i] = model.weights<float>(i).template cast<Scalar>();
+          biases[i]  = model.biases<float>(i).template cast<Scalar>();
+        }
+      else
+        {
+          weights[i] = model.weights<double>(i).template cast<Scalar>();
+          biases[i]  = model.biases<double>(i).template cast<Scalar>();
+        }
+    }
+  return true;
+}
+
+template <typename Scalar> bool BasicNeuralNetwork<Scalar>::loadLegacyWeights(const std::string &filename)
 {
   std::ifstream file(filename);
   if(!file.is_open())
@@ -93,17 +204,24 @@ bool AndresNeuralNetwork::loadWeights(const std::string &filename)
       return false;
     }
 
-  std::vector<Eigen::MatrixXd> loadedWeights;
+  std::vector<Matrix>          loadedWeights;
   std::string                  line;
   int                          weightIndex = 0;
   std::vector<double>          line_data;
 
-  while(getline(file, line))
+  // files written on Windows end their lines with "\r\n"
+  auto readLine = [&file](std::string &line) -> bool {
+    if(!getline(file, line)) return false;
+    if(!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+  };
+
+  while(readLine(line))
     {
       if(line == TOPOLOGY_SEPARATOR)
         {
           topology.clear();
-          while(getline(file, line))
+          while(readLine(line))
             {
               if(line == TOPOLOGY_SEPARATOR) { break; }
               topology.push_back(std::stoi(line));
@@ -118,7 +236,7 @@ bool AndresNeuralNetwork::loadWeights(const std::string &filename)
             {
               int             rownum = weights[weightIndex].rows();
               int             colnum = weights[weightIndex].cols();
-              Eigen::MatrixXd weight(rownum, colnum);
+              Matrix          weight(rownum, colnum);
               for(int i = 0; i < rownum; ++i)
                 for(int j = 0; j < colnum; ++j)
                   {
@@ -151,43 +269,102 @@ bool AndresNeuralNetwork::loadWeights(const std::string &filename)
   return true;
 }
 
-void AndresNeuralNetwork::saveWeights(const std::string &filename) const
-{
-  const static IOFormat CSVFormat(FullPrecision, DontAlignCols, COLUMN_SEPARATOR, "\n");
+template <typename Scalar> bool BasicNeuralNetwork<Scalar>::saveWeights(const std::string &filename) const { return ModelFile::write(filename, topology, activation_types, weights, biases); }
 
-  ofstream file(filename);
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::setAlpha(double alpha) { optimizer->setMomentum(alpha); }
 
-  if(!file.is_open())
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::setEta(double eta) { optimizer->setLearningRate(eta); }
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::copyParameters(const BasicNeuralNetwork &source)
+{
+  if(topology != source.topology)
+    {
+      topology = source.topology;
+      allocateLayers();
+    }
+  activation_types = source.activation_types;
+  for(int i = 0; i < weights.size(); ++i)
     {
-      cerr << "Error opening file: " << filename << endl;
-      return;
+      weights[i] = source.weights[i];
+      biases[i]  = source.biases[i];
     }
+}
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::setOptimizer(OptimizerType type)
+{
+  optimizer = BasicOptimizer<Scalar>::create(type, optimizer->getLearningRate(), optimizer->getMomentum());
+  optimizer->reset(topology);
+}
 
-  file << TOPOLOGY_SEPARATOR << "\n";
-  for(const auto &layer : topology) { file << layer << "\n"; }
-  file << TOPOLOGY_SEPARATOR << "\n";
-  for(const auto &weight : weights) { file << weight.format(CSVFormat) << "\n" MATRIX_SEPARATOR "\n"; }
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::reserveBatch(int capacity) { reserveWorkspace(workspace, capacity); }
 
-  file.close();
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::reserveWorkspace(Workspace &ws, int capacity, bool training) const
+{
+  int layers  = training ? weights.size() : 0;
+  ws.capacity = std::max(capacity, 1);
+  ws.cols     = 0;
+  ws.activations.resize(topology.size());
+  ws.deltas.resize(layers);
+  ws.weight_gradients.resize(layers);
+  ws.bias_gradients.resize(layers);
+
+  for(int i = 0; i < topology.size(); ++i) { ws.activations[i].resize(topology[i], ws.capacity); }
+  for(int i = 0; i < layers; ++i)
+    {
+      ws.deltas[i].resize(topology[i + 1], ws.capacity);
+      ws.weight_gradients[i].resize(topology[i + 1], topology[i]);
+      ws.bias_gradients[i].resize(topology[i + 1]);
+    }
 }
 
-void AndresNeuralNetwork::setAlpha(double alpha) { momentum = alpha; }
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::allocateLayers()
+{
+  weights.resize(topology.size() - 1);
+  biases.resize(topology.size() - 1);
+
+  for(int i = 0; i < topology.size() - 1; ++i)
+    {
+      weights[i].resize(topology[i + 1], topology[i]);
+      biases[i].resize(topology[i + 1]);
+    }
 
-void AndresNeuralNetwork::setEta(double eta) { learning_rate = eta; }
+  optimizer->reset(topology);
+  reserveWorkspace(workspace, workspace.capacity);
+}
 
-void AndresNeuralNetwork::setTopology(const vector<int> &newTopology)
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::setTopology(const vector<int> &newTopology)
 {
   topology = newTopology;
-  weights.clear();
-  prev_weight_update.clear();
-  biases.clear();
-  deltas.clear();
-  activations.clear();
 
-  for(int i = 0; i < topology.size() - 1; ++i)
+  // a new layer count keeps the hidden and output activations
+  if(activation_types.size() != topology.size() - 1)
+    {
+      ActivationType output = activation_types.empty() ? ActivationType::Sigmoid : activation_types.back();
+      ActivationType hidden = activation_types.size() > 1 ? activation_types.front() : (output == ActivationType::Softmax ? ActivationType::Sigmoid : output);
+      activation_types.assign(topology.size() - 1, hidden);
+      activation_types.back() = output;
+    }
+
+  allocateLayers();
+
+  for(int i = 0; i < weights.size(); ++i)
+    {
+      weights[i].setRandom();
+      biases[i].setRandom();
+    }
+}
+
+
+template <typename Scalar> void BasicNeuralNetwork<Scalar>::setActivations(const vector<ActivationType> &activations)
+{
+  if(activations.size() != topology.size() - 1) { throw std::invalid_argument("One activation function per layer is required"); }
+  for(size_t i = 0; i + 1 < activations.size(); ++i)
     {
-      weights.push_back(MatrixXd::Random(topology[i + 1], topology[i]));
-      prev_weight_update.push_back(MatrixXd::Zero(topology[i + 1], topology[i]));
-      biases.push_back(VectorXd::Random(topology[i + 1]));
+      if(activations[i] == ActivationType::Softmax) { throw std::invalid_argument("Softmax is only supported on the output layer"); }
     }
+
+  activation_types = activations;
 }
+
+template class BasicNeuralNetwork<double>;
+template class BasicNeuralNetwork<float>;
@@ -0,0 +1,168 @@
+/**
+ * @file checkpoint.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the background checkpoint writer
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "checkpoint.hh"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Flush a file, or the entries of a directory, from the OS cache to the disk.
+ * @param path File or directory to flush.
+ * @return True if the data reached the disk, or the platform needs no separate flush.
+ */
+static bool syncToDisk(const std::string &path)
+{
+#ifdef _WIN32
+  // directory entries are journaled by NTFS and can not be flushed through a handle
+  if(std::filesystem::is_directory(path)) return true;
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE) return false;
+  bool synced = FlushFileBuffers(file) != 0;
+  CloseHandle(file);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+  bool synced = ::fsync(fd) == 0;
+  ::close(fd);
+#endif
+  return synced;
+}
+
+template <typename Scalar> BasicCheckpointer<Scalar>::BasicCheckpointer(const std::string &prefix, int keep, int every_epochs, double every_seconds) : prefix(prefix), keep(std::max(keep, 1)), every_epochs(every_epochs), every_seconds(every_seconds), last_submit(std::chrono::steady_clock::now())
+{
+  writer = std::thread(&BasicCheckpointer::writerLoop, this);
+}
+
+template <typename Scalar> BasicCheckpointer<Scalar>::~BasicCheckpointer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake_cv.notify_all();
+  writer.join();
+}
+
+template <typename Scalar> bool BasicCheckpointer<Scalar>::epochEnded(const Snapshot &snapshot, int epoch)
+{
+  bool by_epoch = every_epochs > 0 && epoch % every_epochs == 0;
+  bool by_time  = every_seconds > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - last_submit).count() >= every_seconds;
+  if(!by_epoch && !by_time) return false;
+  submit(snapshot, epoch);
+  return true;
+}
+
+template <typename Scalar> void BasicCheckpointer<Scalar>::submit(const Snapshot &snapshot, int epoch)
+{
+  if(snapshot == nullptr) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending       = snapshot;
+    pending_epoch = epoch;
+  }
+  last_submit = std::chrono::steady_clock::now();
+  wake_cv.notify_one();
+}
+
+template <typename Scalar> void BasicCheckpointer<Scalar>::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  idle_cv.wait(lock, [this] { return pending == nullptr && !writing; });
+}
+
+template <typename Scalar> std::string BasicCheckpointer<Scalar>::getLastPath()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return last_path;
+}
+
+template <typename Scalar> void BasicCheckpointer<Scalar>::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  for(;;)
+    {
+      wake_cv.wait(lock, [this] { return pending != nullptr || stopping; });
+      // the waiting checkpoint is still written when stopping
+      if(pending == nullptr) break;
+
+      Snapshot snapshot = std::move(pending);
+      int      epoch    = pending_epoch;
+      pending           = nullptr;
+      writing           = true;
+      lock.unlock();
+      write(snapshot, epoch);
+      snapshot = nullptr;
+      lock.lock();
+      writing = false;
+      idle_cv.notify_all();
+    }
+}
+
+template <typename Scalar> void BasicCheckpointer<Scalar>::write(const Snapshot &snapshot, int epoch)
+{
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "-%06d.model", epoch);
+  std::string     path = prefix + suffix;
+  std::string     temp = path + ".tmp";
+  std::error_code error;
+
+  std::filesystem::path parent = std::filesystem::path(path).parent_path();
+  if(!parent.empty()) std::filesystem::create_directories(parent, error);
+
+  // a reader of the final name sees the old file or the complete new one; the data is on disk before
+  // the rename, so after a power loss the new name never points at a file the OS had not written yet
+  if(!snapshot->saveWeights(temp))
+    {
+      std::filesystem::remove(temp, error);
+      return;
+    }
+  if(!syncToDisk(temp))
+    {
+      std::cerr << "Error flushing checkpoint: " << temp << std::endl;
+      std::filesystem::remove(temp, error);
+      return;
+    }
+  std::filesystem::rename(temp, path, error);
+  if(error)
+    {
+      std::cerr << "Error writing checkpoint: " << path << ": " << error.message() << std::endl;
+      std::filesystem::remove(temp, error);
+      return;
+    }
+  // the rename itself is only durable once the directory is
+  if(!syncToDisk(parent.empty() ? "." : parent.string())) std::cerr << "Error flushing checkpoint directory: " << path << std::endl;
+
+  // an epoch written again, as the best one restored after early stopping, moves to the back
+  // instead of being listed twice, so trimming its older entry never deletes the file just written
+  files.erase(std::remove(files.begin(), files.end(), path), files.end());
+  files.push_back(path);
+  while(files.size() > static_cast<size_t>(keep) && files.front() != path)
+    {
+      std::filesystem::remove(files.front(), error);
+      files.pop_front();
+    }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  last_path = path;
+}
+
+template class BasicCheckpointer<double>;
+template class BasicCheckpointer<float>;
@@ -0,0 +1,218 @@
+/**
+ * @file dataset.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the streaming CSV dataset
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "dataset.hh"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/**
+ * @brief Parse a number at the start of a field.
+ * @param begin Start of the field, leading blanks are skipped.
+ * @param end End of the line.
+ * @param value Parsed value.
+ * @return Position after the number, nullptr if the field is not a number.
+ */
+static const char *parseNumber(const char *begin, const char *end, double &value)
+{
+  while(begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto result = std::from_chars(begin, end, value);
+  return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+  // the chunk buffer is null terminated, strtod stops at the separator anyway
+  char *stop;
+  value = std::strtod(begin, &stop);
+  return stop == begin || stop > end ? nullptr : stop;
+#endif
+}
+
+/**
+ * @brief Count the lines of a file.
+ * @param file Stream positioned at the start, rewound on return.
+ * @return Number of lines, a last line without line break included.
+ */
+static int countLines(std::ifstream &file)
+{
+  std::vector<char> buffer(DATASET_CHUNK_SIZE);
+  int               lines = 0;
+  char              last  = '\n';
+
+  while(file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+    {
+      const char *p   = buffer.data();
+      const char *end = p + file.gcount();
+      while((p = static_cast<const char *>(std::memchr(p, '\n', end - p))) != nullptr)
+        {
+          ++lines;
+          ++p;
+        }
+      last = end[-1];
+    }
+  if(last != '\n') ++lines;
+
+  file.clear();
+  file.seekg(0);
+  return lines;
+}
+
+template <typename Scalar> BasicCsvDataset<Scalar>::BasicCsvDataset(int features, int targets, int id_columns) : feature_count(features), target_count(targets), id_count(id_columns) {}
+
+template <typename Scalar> BasicCsvDataset<Scalar>::~BasicCsvDataset() { cancel(); }
+
+template <typename Scalar> bool BasicCsvDataset<Scalar>::open(const std::string &filename)
+{
+  cancel();
+
+  std::ifstream file(filename, std::ios::binary);
+  if(!file.is_open())
+    {
+      std::cerr << "Error opening file: " << filename << std::endl;
+      return false;
+    }
+
+  std::string header;
+  getline(file, header);
+  if(!header.empty() && header.back() == '\r') header.pop_back();
+  file.seekg(0);
+
+  column_names.clear();
+  std::stringstream ss(header);
+  std::string       name;
+  while(getline(ss, name, ',')) { column_names.push_back(name); }
+
+  // the matrices are sized once here so the loader never reallocates them under a reader
+  rows = std::max(countLines(file) - 1, 0);
+  features.resize(feature_count, rows);
+  targets.resize(target_count, rows);
+  ids.assign(rows, 0);
+
+  failed = false;
+  rows_ready.store(0, std::memory_order_release);
+  complete.store(false, std::memory_order_release);
+  cancelled.store(false, std::memory_order_release);
+  loader = std::thread(&BasicCsvDataset::parse, this, filename);
+  return true;
+}
+
+template <typename Scalar> bool BasicCsvDataset<Scalar>::wait()
+{
+  if(loader.joinable()) loader.join();
+  return !failed;
+}
+
+template <typename Scalar> int BasicCsvDataset<Scalar>::waitForRows(int count)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  ready_cv.wait(lock, [this, count] { return rowsReady() >= count || isComplete(); });
+  return rowsReady();
+}
+
+template <typename Scalar> void BasicCsvDataset<Scalar>::cancel()
+{
+  cancelled.store(true, std::memory_order_release);
+  if(loader.joinable()) loader.join();
+}
+
+template <typename Scalar> void BasicCsvDataset<Scalar>::publish(int count, bool done)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    rows_ready.store(count, std::memory_order_release);
+    if(done) complete.store(true, std::memory_order_release);
+  }
+  ready_cv.notify_all();
+}
+
+template <typename Scalar> bool BasicCsvDataset<Scalar>::parseLine(const char *begin, const char *end, int row)
+{
+  const char *p = begin;
+
+  for(int column = 0; column < id_count + feature_count + target_count; ++column)
+    {
+      if(column > 0)
+        {
+          p = static_cast<const char *>(std::memchr(p, ',', end - p));
+          if(p == nullptr) return false;
+          ++p;
+        }
+
+      double      value;
+      const char *next = parseNumber(p, end, value);
+      if(column < id_count)
+        {
+          // id columns may hold text, only the first one is kept when it is numeric
+          if(column == 0 && next != nullptr) ids[row] = static_cast<int>(value);
+          continue;
+        }
+      if(next == nullptr) return false;
+
+      if(column < id_count + feature_count) features(column - id_count, row) = static_cast<Scalar>(value);
+      else targets(column - id_count - feature_count, row) = static_cast<Scalar>(value);
+      p = next;
+    }
+  return true;
+}
+
+template <typename Scalar> void BasicCsvDataset<Scalar>::parse(const std::string &filename)
+{
+  std::ifstream     file(filename, std::ios::binary);
+  std::vector<char> buffer(DATASET_CHUNK_SIZE + 1);
+  size_t            carry  = 0;
+  int               row    = 0;
+  int               line   = 0;
+  bool              at_eof = false;
+
+  while(!at_eof && !failed && !cancelled.load(std::memory_order_acquire))
+    {
+      file.read(buffer.data() + carry, buffer.size() - 1 - carry);
+      size_t size  = carry + file.gcount();
+      at_eof       = !file;
+      buffer[size] = '\0';
+
+      const char *p   = buffer.data();
+      const char *end = p + size;
+      while(p < end && !failed)
+        {
+          const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+          if(eol == nullptr && !at_eof) break;
+          if(eol == nullptr) eol = end;
+
+          const char *line_end = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+          // the first line is the header, blank lines are skipped
+          if(line++ > 0 && line_end > p && row < rows)
+            {
+              if(parseLine(p, line_end, row)) { ++row; }
+              else
+                {
+                  std::cerr << "Error parsing line " << line << " of file: " << filename << std::endl;
+                  failed = true;
+                }
+            }
+          p = eol < end ? eol + 1 : end;
+        }
+
+      // keep the partial last line for the next chunk, growing the buffer for very long lines
+      carry = end - p;
+      std::memmove(buffer.data(), p, carry);
+      if(carry == buffer.size() - 1) buffer.resize(buffer.size() * 2);
+      publish(row, false);
+    }
+
+  publish(row, true);
+}
+
+template class BasicCsvDataset<double>;
+template class BasicCsvDataset<float>;
@@ -0,0 +1,275 @@
+/**
+ * @file model.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the binary model format
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "model.hh"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/**
+ * @brief Round a byte count up to the next alignment boundary.
+ * @param bytes Byte count.
+ * @return Aligned byte count.
+ */
+static size_t alignUp(size_t bytes) { return (bytes + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT; }
+
+/**
+ * @brief Fold a buffer into a FNV-1a hash, one 64-bit word at a time.
+ * @param hash Running hash.
+ * @param data Buffer, its size must be a multiple of 8 bytes.
+ * @param bytes Size of the buffer.
+ * @return Updated hash.
+ */
+static uint64_t checksum(uint64_t hash, const unsigned char *data, size_t bytes)
+{
+  for(size_t i = 0; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+    {
+      uint64_t word;
+      std::memcpy(&word, data + i, sizeof(word));
+      hash = (hash ^ word) * FNV_PRIME;
+    }
+  return hash;
+}
+
+/**
+ * @brief Compute the offsets of every block for a topology.
+ * @param topology Topology of the network.
+ * @param version Format version, the activation table exists since version 2.
+ * @param scalar_size Size of one weight or bias value in bytes.
+ * @param weight_offsets Filled with the offset of each weight block.
+ * @param bias_offsets Filled with the offset of each bias block.
+ * @return Total size of the file in bytes.
+ */
+static size_t layout(const std::vector<int> &topology, uint32_t version, size_t scalar_size, std::vector<size_t> &weight_offsets, std::vector<size_t> &bias_offsets)
+{
+  size_t offset = sizeof(ModelHeader) + alignUp(topology.size() * sizeof(int32_t));
+  if(version >= 2) offset += alignUp((topology.size() - 1) * sizeof(uint32_t));
+
+  weight_offsets.clear();
+  bias_offsets.clear();
+  for(size_t i = 0; i + 1 < topology.size(); ++i)
+    {
+      weight_offsets.push_back(offset);
+      offset += alignUp(size_t(topology[i + 1]) * topology[i] * scalar_size);
+      bias_offsets.push_back(offset);
+      offset += alignUp(size_t(topology[i + 1]) * scalar_size);
+    }
+  return offset;
+}
+
+ModelFile::~ModelFile() { close(); }
+
+bool ModelFile::isModelFile(const std::string &filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  char          magic[sizeof(ModelHeader::magic)] = {};
+
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, MODEL_MAGIC, sizeof(magic)) == 0;
+}
+
+bool ModelFile::open(const std::string &filename)
+{
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+    {
+      std::cerr << "Error opening file: " << filename << std::endl;
+      return false;
+    }
+  LARGE_INTEGER file_size;
+  GetFileSizeEx(file, &file_size);
+  HANDLE mapping = file_size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+  void  *view    = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  file_handle    = file;
+  map_handle     = mapping;
+  size           = static_cast<size_t>(file_size.QuadPart);
+#else
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0)
+    {
+      std::cerr << "Error opening file: " << filename << std::endl;
+      return false;
+    }
+  struct stat st;
+  fstat(fd, &st);
+  void *view = st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if(view == MAP_FAILED) { view = nullptr; }
+  size = static_cast<size_t>(st.st_size);
+#endif
+
+  data = static_cast<const unsigned char *>(view);
+  if(data == nullptr || size < sizeof(ModelHeader))
+    {
+      std::cerr << "Error mapping model file: " << filename << std::endl;
+      close();
+      return false;
+    }
+
+  ModelHeader header;
+  std::memcpy(&header, data, sizeof(header));
+
+  bool valid = std::memcmp(header.magic, MODEL_MAGIC, sizeof(header.magic)) == 0 && header.version >= 1 && header.version <= MODEL_VERSION && (header.dtype == ModelDType::Float64 || header.dtype == ModelDType::Float32) && header.layers >= 2 && header.file_size == size && header.layers <= (size - sizeof(ModelHeader)) / sizeof(int32_t);
+  if(valid)
+    {
+      topology.resize(header.layers);
+      std::memcpy(topology.data(), data + sizeof(ModelHeader), header.layers * sizeof(int32_t));
+      for(int layer : topology) valid = valid && layer > 0;
+    }
+  valid = valid && layout(topology, header.version, header.dtype == ModelDType::Float32 ? sizeof(float) : sizeof(double), weight_offsets, bias_offsets) == size && header.payload_offset == weight_offsets.front();
+  valid = valid && checksum(FNV_OFFSET_BASIS, data + sizeof(ModelHeader), size - sizeof(ModelHeader)) == header.checksum;
+
+  if(!valid)
+    {
+      std::cerr << "Invalid or corrupted model file: " << filename << std::endl;
+      close();
+      return false;
+    }
+
+  dtype = header.dtype;
+
+  std::vector<uint32_t> table(header.layers - 1, header.activation);
+  if(header.version >= 2) std::memcpy(table.data(), data + sizeof(ModelHeader) + alignUp(header.layers * sizeof(int32_t)), table.size() * sizeof(uint32_t));
+
+  activations.clear();
+  for(size_t i = 0; i < table.size(); ++i)
+    {
+      if(table[i] > static_cast<uint32_t>(ActivationType::Softmax) || (table[i] == static_cast<uint32_t>(ActivationType::Softmax) && i + 1 < table.size()))
+        {
+          std::cerr << "Invalid activation in model file: " << filename << std::endl;
+          close();
+          return false;
+        }
+      activations.push_back(static_cast<ActivationType>(table[i]));
+    }
+  return true;
+}
+
+void ModelFile::close()
+{
+#ifdef _WIN32
+  if(data != nullptr) UnmapViewOfFile(data);
+  if(map_handle != nullptr) CloseHandle(map_handle);
+  if(file_handle != nullptr) CloseHandle(file_handle);
+#else
+  if(data != nullptr) munmap(const_cast<unsigned char *>(data), size);
+#endif
+  data        = nullptr;
+  size        = 0;
+  dtype       = ModelDType::Float64;
+  file_handle = nullptr;
+  map_handle  = nullptr;
+  topology.clear();
+  activations.clear();
+  weight_offsets.clear();
+  bias_offsets.clear();
+}
+
+template <typename Scalar> ModelFile::ConstMatrixMap<Scalar> ModelFile::weights(int layer) const
+{
+  if(dtype != ModelDTypeOf<Scalar>::value) { throw std::logic_error("Scalar type does not match the model file"); }
+  return ConstMatrixMap<Scalar>(reinterpret_cast<const Scalar *>(data + weight_offsets.at(layer)), topology[layer + 1], topology[layer]);
+}
+
+template <typename Scalar> ModelFile::ConstVectorMap<Scalar> ModelFile::biases(int layer) const
+{
+  if(dtype != ModelDTypeOf<Scalar>::value) { throw std::logic_error("Scalar type does not match the model file"); }
+  return ConstVectorMap<Scalar>(reinterpret_cast<const Scalar *>(data + bias_offsets.at(layer)), topology[layer + 1]);
+}
+
+template <typename Scalar> bool ModelFile::write(const std::string &filename, const std::vector<int> &topology, const std::vector<ActivationType> &activations, const std::vector<Matrix<Scalar, Dynamic, Dynamic>> &weights, const std::vector<Matrix<Scalar, Dynamic, 1>> &biases)
+{
+  std::vector<size_t> weight_offsets, bias_offsets;
+  ModelHeader         header = {};
+
+  std::memcpy(header.magic, MODEL_MAGIC, sizeof(header.magic));
+  header.version        = MODEL_VERSION;
+  header.dtype          = ModelDTypeOf<Scalar>::value;
+  header.activation     = activations.empty() ? 0 : static_cast<uint32_t>(activations.back());
+  header.layers         = topology.size();
+  header.file_size      = layout(topology, MODEL_VERSION, sizeof(Scalar), weight_offsets, bias_offsets);
+  header.payload_offset = weight_offsets.empty() ? header.file_size : weight_offsets.front();
+  header.checksum       = FNV_OFFSET_BASIS;
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if(!file.is_open())
+    {
+      std::cerr << "Error opening file: " << filename << std::endl;
+      return false;
+    }
+
+  static const unsigned char padding[MODEL_ALIGNMENT] = {};
+
+  // sections are padded to the alignment, so the checksum can run on whole words; a float block
+  // may end in the middle of a word, which is folded together with the start of the padding
+  auto section = [&file, &header](const void *bytes, size_t count) {
+    size_t        padded = alignUp(count);
+    size_t        whole  = count / sizeof(uint64_t) * sizeof(uint64_t);
+    unsigned char tail[MODEL_ALIGNMENT + sizeof(uint64_t)] = {};
+
+    std::memcpy(tail, static_cast<const unsigned char *>(bytes) + whole, count - whole);
+    file.write(static_cast<const char *>(bytes), count);
+    file.write(reinterpret_cast<const char *>(padding), padded - count);
+    header.checksum = checksum(header.checksum, static_cast<const unsigned char *>(bytes), whole);
+    header.checksum = checksum(header.checksum, tail, padded - whole);
+  };
+
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  std::vector<int32_t> table(alignUp(topology.size() * sizeof(int32_t)) / sizeof(int32_t), 0);
+  std::copy(topology.begin(), topology.end(), table.begin());
+  section(table.data(), table.size() * sizeof(int32_t));
+
+  std::vector<uint32_t> kinds(alignUp(activations.size() * sizeof(uint32_t)) / sizeof(uint32_t), 0);
+  for(size_t i = 0; i < activations.size(); ++i) kinds[i] = static_cast<uint32_t>(activations[i]);
+  section(kinds.data(), kinds.size() * sizeof(uint32_t));
+  for(size_t i = 0; i < weights.size(); ++i)
+    {
+      section(weights[i].data(), weights[i].size() * sizeof(Scalar));
+      section(biases[i].data(), biases[i].size() * sizeof(Scalar));
+    }
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.close();
+
+  if(!file)
+    {
+      std::cerr << "Error writing model file: " << filename << std::endl;
+      return false;
+    }
+  return true;
+}
+
+template ModelFile::ConstMatrixMap<double> ModelFile::weights<double>(int) const;
+template ModelFile::ConstMatrixMap<float>  ModelFile::weights<float>(int) const;
+template ModelFile::ConstVectorMap<double> ModelFile::biases<double>(int) const;
+template ModelFile::ConstVectorMap<float>  ModelFile::biases<float>(int) const;
+template bool ModelFile::write<double>(const std::string &, const std::vector<int> &, const std::vector<ActivationType> &, const std::vector<MatrixXd> &, const std::vector<VectorXd> &);
+template bool ModelFile::write<float>(const std::string &, const std::vector<int> &, const std::vector<ActivationType> &, const std::vector<MatrixXf> &, const std::vector<VectorXf> &);
@@ -0,0 +1,168 @@
+/**
+ * @file optimizer.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the gradient descent optimizers
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "optimizer.hh"
+#include <cmath>
+
+/**
+ * @brief Momentum update of one parameter block.
+ * @param param Weights or biases, updated in place.
+ * @param velocity Velocity of the block, updated in place.
+ * @param gradient Gradient summed over the batch.
+ * @param scale Inverse of the batch size.
+ * @param lr Learning rate.
+ * @param mu Momentum.
+ * @param nesterov Whether to look ahead along the updated velocity.
+ */
+template <typename Plain> static void momentumUpdate(Plain &param, Plain &velocity, const Plain &gradient, typename Plain::Scalar scale, typename Plain::Scalar lr, typename Plain::Scalar mu, bool nesterov)
+{
+  velocity.array() = mu * velocity.array() + scale * gradient.array();
+  if(nesterov) { param.array() -= lr * (scale * gradient.array() + mu * velocity.array()); }
+  else { param.array() -= lr * velocity.array(); }
+}
+
+/**
+ * @brief RMSProp update of one parameter block.
+ * @param param Weights or biases, updated in place.
+ * @param square Running average of the squared gradient, updated in place.
+ * @param gradient Gradient summed over the batch.
+ * @param scale Inverse of the batch size.
+ * @param lr Learning rate.
+ */
+template <typename Plain> static void rmspropUpdate(Plain &param, Plain &square, const Plain &gradient, typename Plain::Scalar scale, typename Plain::Scalar lr)
+{
+  typedef typename Plain::Scalar Scalar;
+  const Scalar                   rho = Scalar(OPTIMIZER_RMSPROP_DECAY);
+  const Scalar                   eps = Scalar(OPTIMIZER_EPSILON);
+
+  square.array() = rho * square.array() + (1 - rho) * (scale * gradient.array()).square();
+  param.array() -= lr * scale * gradient.array() / (square.array().sqrt() + eps);
+}
+
+/**
+ * @brief Adam update of one parameter block.
+ * @param param Weights or biases, updated in place.
+ * @param mean Running average of the gradient, updated in place.
+ * @param square Running average of the squared gradient, updated in place.
+ * @param gradient Gradient summed over the batch.
+ * @param scale Inverse of the batch size.
+ * @param step_size Learning rate with the bias correction folded in.
+ */
+template <typename Plain> static void adamUpdate(Plain &param, Plain &mean, Plain &square, const Plain &gradient, typename Plain::Scalar scale, typename Plain::Scalar step_size)
+{
+  typedef typename Plain::Scalar Scalar;
+  const Scalar                   beta1 = Scalar(OPTIMIZER_ADAM_BETA1);
+  const Scalar                   beta2 = Scalar(OPTIMIZER_ADAM_BETA2);
+  const Scalar                   eps   = Scalar(OPTIMIZER_EPSILON);
+
+  mean.array()   = beta1 * mean.array() + (1 - beta1) * scale * gradient.array();
+  square.array() = beta2 * square.array() + (1 - beta2) * (scale * gradient.array()).square();
+  param.array() -= step_size * mean.array() / (square.array().sqrt() + eps);
+}
+
+template <typename Scalar> std::unique_ptr<BasicOptimizer<Scalar>> BasicOptimizer<Scalar>::create(OptimizerType type, double learning_rate, double momentum)
+{
+  switch(type)
+    {
+    case OptimizerType::Nesterov: return std::make_unique<NesterovOptimizer<Scalar>>(learning_rate, momentum);
+    case OptimizerType::RMSProp: return std::make_unique<RMSPropOptimizer<Scalar>>(learning_rate, momentum);
+    case OptimizerType::Adam: return std::make_unique<AdamOptimizer<Scalar>>(learning_rate, momentum);
+    default: return std::make_unique<SGDOptimizer<Scalar>>(learning_rate, momentum);
+    }
+}
+
+template <typename Scalar> void BasicOptimizer<Scalar>::allocate(const std::vector<int> &topology, std::vector<Matrix> &weight_state, std::vector<Vector> &bias_state)
+{
+  weight_state.resize(topology.size() - 1);
+  bias_state.resize(topology.size() - 1);
+  for(int i = 0; i + 1 < topology.size(); ++i)
+    {
+      weight_state[i].setZero(topology[i + 1], topology[i]);
+      bias_state[i].setZero(topology[i + 1]);
+    }
+}
+
+template <typename Scalar> void SGDOptimizer<Scalar>::reset(const std::vector<int> &topology) { this->allocate(topology, weight_velocity, bias_velocity); }
+
+template <typename Scalar> void SGDOptimizer<Scalar>::step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples)
+{
+  Scalar scale = Scalar(1.0 / samples);
+  Scalar lr    = Scalar(this->getLearningRate());
+  Scalar mu    = Scalar(this->getMomentum());
+
+  for(int i = 0; i < weights.size(); ++i)
+    {
+      momentumUpdate(weights[i], weight_velocity[i], weight_gradients[i], scale, lr, mu, false);
+      momentumUpdate(biases[i], bias_velocity[i], bias_gradients[i], scale, lr, mu, false);
+    }
+}
+
+template <typename Scalar> void NesterovOptimizer<Scalar>::reset(const std::vector<int> &topology) { this->allocate(topology, weight_velocity, bias_velocity); }
+
+template <typename Scalar> void NesterovOptimizer<Scalar>::step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples)
+{
+  Scalar scale = Scalar(1.0 / samples);
+  Scalar lr    = Scalar(this->getLearningRate());
+  Scalar mu    = Scalar(this->getMomentum());
+
+  for(int i = 0; i < weights.size(); ++i)
+    {
+      momentumUpdate(weights[i], weight_velocity[i], weight_gradients[i], scale, lr, mu, true);
+      momentumUpdate(biases[i], bias_velocity[i], bias_gradients[i], scale, lr, mu, true);
+    }
+}
+
+template <typename Scalar> void RMSPropOptimizer<Scalar>::reset(const std::vector<int> &topology) { this->allocate(topology, weight_square, bias_square); }
+
+template <typename Scalar> void RMSPropOptimizer<Scalar>::step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples)
+{
+  Scalar scale = Scalar(1.0 / samples);
+  Scalar lr    = Scalar(this->getLearningRate());
+
+  for(int i = 0; i < weights.size(); ++i)
+    {
+      rmspropUpdate(weights[i], weight_square[i], weight_gradients[i], scale, lr);
+      rmspropUpdate(biases[i], bias_square[i], bias_gradients[i], scale, lr);
+    }
+}
+
+template <typename Scalar> void AdamOptimizer<Scalar>::reset(const std::vector<int> &topology)
+{
+  this->allocate(topology, weight_mean, bias_mean);
+  this->allocate(topology, weight_square, bias_square);
+  steps = 0;
+}
+
+template <typename Scalar> void AdamOptimizer<Scalar>::step(std::vector<Matrix> &weights, std::vector<Vector> &biases, const std::vector<Matrix> &weight_gradients, const std::vector<Vector> &bias_gradients, int samples)
+{
+  ++steps;
+  // bias correction of both running averages folded into the step size
+  double correction = std::sqrt(1.0 - std::pow(OPTIMIZER_ADAM_BETA2, steps)) / (1.0 - std::pow(OPTIMIZER_ADAM_BETA1, steps));
+  Scalar scale      = Scalar(1.0 / samples);
+  Scalar step_size  = Scalar(this->getLearningRate() * correction);
+
+  for(int i = 0; i < weights.size(); ++i)
+    {
+      adamUpdate(weights[i], weight_mean[i], weight_square[i], weight_gradients[i], scale, step_size);
+      adamUpdate(biases[i], bias_mean[i], bias_square[i], bias_gradients[i], scale, step_size);
+    }
+}
+
+template class BasicOptimizer<double>;
+template class BasicOptimizer<float>;
+template class SGDOptimizer<double>;
+template class SGDOptimizer<float>;
+template class NesterovOptimizer<double>;
+template class NesterovOptimizer<float>;
+template class RMSPropOptimizer<double>;
+template class RMSPropOptimizer<float>;
+template class AdamOptimizer<double>;
+template class AdamOptimizer<float>;
@@ -0,0 +1,47 @@
+/**
+ * @file shuffle.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the shuffled mini-batch gatherer
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "shuffle.hh"
+#include <algorithm>
+#include <numeric>
+
+template <typename Scalar> BasicBatchShuffler<Scalar>::BasicBatchShuffler(unsigned seed) : generator(seed) {}
+
+template <typename Scalar> void BasicBatchShuffler<Scalar>::shuffle(int rows)
+{
+  // the order is rebuilt rather than reshuffled, so the permutation does not depend on the previous one
+  order.resize(rows);
+  std::iota(order.begin(), order.end(), 0u);
+  std::shuffle(order.begin(), order.end(), generator);
+}
+
+template <typename Scalar> void BasicBatchShuffler<Scalar>::gather(const Ref<const Matrix> &features, const Ref<const Matrix> &targets, int first, int count)
+{
+  // the buffers only grow, a smaller last batch uses their leading columns
+  if(inputs.rows() != features.rows() || inputs.cols() < count) inputs.resize(features.rows(), std::max<Index>(count, inputs.cols()));
+  if(this->targets.rows() != targets.rows() || this->targets.cols() < count) this->targets.resize(targets.rows(), std::max<Index>(count, this->targets.cols()));
+
+  this->first = first;
+  this->count = count;
+  for(int i = 0; i < count; ++i)
+    {
+      inputs.col(i)        = features.col(order[first + i]);
+      this->targets.col(i) = targets.col(order[first + i]);
+    }
+}
+
+template <typename Scalar> void BasicBatchShuffler<Scalar>::scatter(const Ref<const Matrix> &results, Ref<Matrix> outputs) const
+{
+  for(int i = 0; i < results.cols(); ++i) outputs.col(order[first + i]) = results.col(i);
+}
+
+template class BasicBatchShuffler<double>;
+template class BasicBatchShuffler<float>;
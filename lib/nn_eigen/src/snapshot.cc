@@ -0,0 +1,42 @@
+/**
+ * @file snapshot.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the weight snapshot publisher
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "snapshot.hh"
+
+template <typename Scalar> void BasicWeightPublisher<Scalar>::publish(const Network &network)
+{
+  // a copy only referenced by this list is neither current nor held by a reader, and can not become so
+  std::shared_ptr<Network> target;
+  for(auto &candidate : published)
+    {
+      if(candidate.use_count() == 1)
+        {
+          // use_count() is a relaxed load: the acquire fence pairs with the release decrement of the
+          // last reader's shared_ptr, so its reads of the weights happen before copyParameters() overwrites them
+          std::atomic_thread_fence(std::memory_order_acquire);
+          target = candidate;
+          break;
+        }
+    }
+
+  if(target == nullptr)
+    {
+      target = std::make_shared<Network>(network.template cast<Scalar>());
+      published.push_back(target);
+    }
+  else { target->copyParameters(network); }
+
+  std::atomic_store_explicit(&current, Snapshot(target), std::memory_order_release);
+  version.fetch_add(1, std::memory_order_release);
+}
+
+template class BasicWeightPublisher<double>;
+template class BasicWeightPublisher<float>;
@@ -0,0 +1,112 @@
+/**
+ * @file trainer.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the data-parallel trainer
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "trainer.hh"
+#include <algorithm>
+
+template <typename Scalar> BasicParallelTrainer<Scalar>::BasicParallelTrainer(Network &network, int threads) : network(network), workspaces(std::max(threads, 1))
+{
+  for(int i = 1; i < workspaces.size(); ++i) { workers.emplace_back(&BasicParallelTrainer::workerLoop, this, i); }
+}
+
+template <typename Scalar> BasicParallelTrainer<Scalar>::~BasicParallelTrainer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start_cv.notify_all();
+  for(auto &worker : workers) { worker.join(); }
+}
+
+template <typename Scalar> void BasicParallelTrainer<Scalar>::reserveBatch(int capacity)
+{
+  // a slice is a fair share of the batch, or under twice the minimum slice when only some threads are active
+  int slice = (capacity + workspaces.size() - 1) / workspaces.size();
+  for(auto &ws : workspaces) { network.reserveWorkspace(ws, std::max(slice, TRAINER_MIN_SLICE * 2)); }
+  outputs.resize(network.getTopology().back(), capacity);
+}
+
+template <typename Scalar> void BasicParallelTrainer<Scalar>::trainBatch(const Ref<const Matrix> &inputs, const Ref<const Matrix> &targets)
+{
+  const int n = inputs.cols();
+  if(n > outputs.cols() || outputs.rows() != targets.rows()) { reserveBatch(n); }
+
+  cols          = n;
+  batch_inputs  = &inputs;
+  batch_targets = &targets;
+  // small batches are not worth waking every thread for
+  active = std::max(1, std::min<int>(workspaces.size(), n / TRAINER_MIN_SLICE));
+
+  if(active > 1)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = workers.size();
+        ++generation;
+      }
+      start_cv.notify_all();
+      trainSlice(0);
+      std::unique_lock<std::mutex> lock(mutex);
+      done_cv.wait(lock, [this] { return pending == 0; });
+    }
+  else { trainSlice(0); }
+
+  // reduce the per-thread gradient sums into the first workspace
+  auto &total = workspaces.front();
+  for(int t = 1; t < active; ++t)
+    for(int i = 0; i < total.weight_gradients.size(); ++i)
+      {
+        total.weight_gradients[i] += workspaces[t].weight_gradients[i];
+        total.bias_gradients[i] += workspaces[t].bias_gradients[i];
+      }
+
+  network.applyGradients(total.weight_gradients, total.bias_gradients, n);
+}
+
+template <typename Scalar> Ref<const typename BasicParallelTrainer<Scalar>::Matrix> BasicParallelTrainer<Scalar>::getResults() const { return outputs.leftCols(cols); }
+
+template <typename Scalar> void BasicParallelTrainer<Scalar>::trainSlice(int index)
+{
+  if(index >= active) { return; }
+
+  const int begin = cols * index / active;
+  const int count = cols * (index + 1) / active - begin;
+  auto     &ws    = workspaces[index];
+
+  network.forwardPropagation(batch_inputs->middleCols(begin, count), ws);
+  outputs.middleCols(begin, count) = ws.activations.back().leftCols(count);
+  network.computeGradients(batch_targets->middleCols(begin, count), ws);
+}
+
+template <typename Scalar> void BasicParallelTrainer<Scalar>::workerLoop(int index)
+{
+  unsigned long seen = 0;
+  while(true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_cv.wait(lock, [this, seen] { return stopping || generation != seen; });
+        if(stopping) { return; }
+        seen = generation;
+      }
+
+      trainSlice(index);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--pending == 0) { done_cv.notify_one(); }
+      }
+    }
+}
+
+template class BasicParallelTrainer<double>;
+template class BasicParallelTrainer<float>;
@@ -0,0 +1,79 @@
+/**
+ * @file validation.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief implementation of the validation pass and early stopping
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "validation.hh"
+#include <algorithm>
+#include <vector>
+
+template <typename Scalar> BasicValidator<Scalar>::BasicValidator(int threads, double threshold, int patience, double target_accuracy) : threads(std::max(threads, 1)), threshold(threshold), patience(patience), target_accuracy(target_accuracy) {}
+
+template <typename Scalar> BasicValidator<Scalar>::~BasicValidator()
+{
+  if(evaluator.joinable()) evaluator.join();
+}
+
+template <typename Scalar> void BasicValidator<Scalar>::start(const Snapshot &snapshot, const Ref<const Matrix> &inputs, const Ref<const Matrix> &targets, int epoch)
+{
+  finish();
+  if(snapshot == nullptr || inputs.cols() == 0) return;
+
+  scored        = snapshot;
+  running       = ValidationResult();
+  running.epoch = epoch;
+  outputs.resize(targets.rows(), targets.cols());
+
+  // plain views of the caller's columns, a Ref copied into the thread could point into a temporary
+  typedef Map<const Matrix, 0, OuterStride<>> View;
+  View in(inputs.data(), inputs.rows(), inputs.cols(), OuterStride<>(inputs.outerStride()));
+  View tg(targets.data(), targets.rows(), targets.cols(), OuterStride<>(targets.outerStride()));
+  evaluator = std::thread([this, in, tg] { evaluate(in, tg); });
+}
+
+template <typename Scalar> void BasicValidator<Scalar>::evaluate(const Ref<const Matrix> &inputs, const Ref<const Matrix> &targets)
+{
+  const int                cols  = inputs.cols();
+  const int                slice = (cols + threads - 1) / threads;
+  std::vector<std::thread> workers;
+
+  // the snapshot is immutable, every thread scores its own range of columns
+  for(int first = slice; first < cols; first += slice)
+    {
+      int count = std::min(slice, cols - first);
+      workers.emplace_back([this, &inputs, first, count] { scored->predict(inputs.middleCols(first, count), outputs.middleCols(first, count)); });
+    }
+  scored->predict(inputs.leftCols(std::min(slice, cols)), outputs.leftCols(std::min(slice, cols)));
+  for(auto &worker : workers) worker.join();
+
+  auto correct     = (((outputs.array() >= Scalar(threshold)).template cast<Scalar>() - targets.array()).abs() < Scalar(0.5)).colwise().all();
+  running.error    = double((outputs - targets).squaredNorm()) / cols;
+  running.accuracy = 100.0 * correct.count() / cols;
+}
+
+template <typename Scalar> bool BasicValidator<Scalar>::finish()
+{
+  if(!evaluator.joinable()) return stop;
+  evaluator.join();
+
+  last = running;
+  if(best_snapshot == nullptr || last.error < best.error)
+    {
+      best          = last;
+      best_snapshot = scored;
+    }
+  scored = nullptr;
+
+  if(target_accuracy > 0 && last.accuracy >= target_accuracy) stop = true;
+  if(patience > 0 && last.epoch - best.epoch >= patience) stop = true;
+  return stop;
+}
+
+template class BasicValidator<double>;
+template class BasicValidator<float>;
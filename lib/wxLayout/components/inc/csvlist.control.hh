@@ -2,19 +2,33 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
 #include <vector>
 #include <wx/wx.h>
 #include <wx/listctrl.h>
-#include <fstream>
-#include <rapidcsv.h>
+#include <dataset.hh>
+
+/**
+ * @brief Number of formatted rows kept by the list control, a few screens worth.
+ */
+#define LIST_CACHE_ROWS 256
+
+/**
+ * @brief Number of rows from which sorting runs on the parallel algorithms.
+ */
+#define LIST_PARALLEL_SORT_ROWS 65536
 
 /**
  * @brief A template class for a virtual list control that displays data from a CSV file.
  *
  * This class inherits from wxListCtrl and provides functionality to display and manipulate data
- * from a CSV file in a virtual list control.
+ * from a CSV file in a virtual list control. The rows live in a table bound to the training
+ * dataset, the control only reads them when a row is painted.
  *
- * @tparam T The type of data to be displayed in the list control.
+ * @tparam T The type of the table displayed in the list control.
  */
 template <typename T> class VirtualListControl : public wxListCtrl
 {
@@ -28,35 +42,24 @@ template <typename T> class VirtualListControl : public wxListCtrl
    * @param id The window ID.
    * @param pos The position of the control.
    * @param size The size of the control.
-   * @param csv_path The path to the CSV file.
+   * @param dataset The dataset holding the rows, it must outlive the control.
    * @param n_f The number of features.
    * @param n_o The number of outputs.
    */
-  VirtualListControl(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size, std::string csv_path, int n_f, int n_o) : wxListCtrl(parent, id, pos, size, wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxLC_HRULES)
+  VirtualListControl(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size, const CsvDataset &dataset, int n_f, int n_o) : wxListCtrl(parent, id, pos, size, wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxLC_HRULES)
   {
     this->num_of_inputs  = n_f;
     this->num_of_outputs = n_o;
-    std::string fullPath = RES_DIR "/" + csv_path;
-    doc.Load(fullPath);
-    auto headers = doc.GetColumnNames();
-    int  col_id  = 0;
-    for(auto header : headers)
-      {
-        this->AppendColumn(header);
-        col_id++;
-      }
-    this->AppendColumn("Prediction");
-    resetData();
-    for(int i = 0; i < col_id; i++) { this->SetColumnWidth(i, wxLIST_AUTOSIZE_USEHEADER); }
+    resetData(dataset);
 
     this->Bind(wxEVT_LIST_COL_CLICK, [this](wxListEvent &event) {
-      auto selected     = this->GetFirstSelectedItem();
-      auto selectedDesc = selected != -1 ? this->items[selected].id : 0;
+      auto selected    = this->GetFirstSelectedItem();
+      auto selectedRow = selected != -1 ? this->rowAt(selected) : -1;
       if(selected != -1) { this->SetItemState(selected, 0, wxLIST_STATE_SELECTED); }
       this->sortByColumn(event.GetColumn());
       if(selected != -1)
         {
-          auto indexToSelect = std::find_if(this->items.begin(), this->items.end(), [selectedDesc](auto item) { return item.id == selectedDesc; }) - this->items.begin();
+          long indexToSelect = this->indexOf(selectedRow);
           this->SetItemState(indexToSelect, wxLIST_STATE_SELECTED, wxLIST_STATE_SELECTED);
           this->EnsureVisible(indexToSelect);
         }
@@ -64,10 +67,6 @@ template <typename T> class VirtualListControl : public wxListCtrl
       this->RefreshAfterUpdate();
     });
 
-    this->Bind(wxEVT_LIST_ITEM_SELECTED, [this](wxListEvent &event) {
-      auto selected = this->GetFirstSelectedItem();
-      if(selected != -1) { auto item = this->items[selected]; }
-    });
   }
 
   /**
@@ -75,20 +74,85 @@ template <typename T> class VirtualListControl : public wxListCtrl
    */
   void RefreshAfterUpdate()
   {
-    this->SetItemCount(items.size());
+    this->SetItemCount(table.size());
     this->Refresh();
   }
 
-  std::vector<T>     items; ///< The items to be displayed in the list control.
-  rapidcsv::Document doc;   ///< The CSV document.
+  /**
+   * @brief Repaints the rows currently on screen.
+   */
+  void RefreshVisible()
+  {
+    long top  = this->GetTopItem();
+    long last = std::min<long>(top + this->GetCountPerPage(), this->GetItemCount() - 1);
+    if(last >= top) { this->RefreshItems(top, last); }
+  }
+
+  T table; ///< The table displayed in the list control.
+
+  /**
+   * @brief Binds the list control to a dataset and clears the predictions.
+   *
+   * The columns are rebuilt from the header of the dataset, so the control
+   * can be created before the file is opened and follows a reopened file.
+   *
+   * @param dataset The dataset holding the rows, it must outlive the control.
+   */
+  void resetData(const CsvDataset &dataset);
+
+  /**
+   * @brief Gets the table row shown at an index of the list.
+   *
+   * @param index The index of the item.
+   * @return The row of the table, rows loaded after the last sort follow in file order.
+   */
+  long rowAt(long index) const { return index < order.size() ? order[index] : index; }
+
+  /**
+   * @brief Gets the index of the list where a table row is shown.
+   *
+   * @param row The row of the table.
+   * @return The index of the item.
+   */
+  long indexOf(long row) const { return row < inverse.size() ? inverse[row] : row; }
 
   /**
-   * @brief Resets the data in the list control.
+   * @brief Drops every formatted row, for when the rows themselves change.
    */
-  void resetData();
+  void invalidateCache()
+  {
+    cache.clear();
+    cache_index.clear();
+  }
 
   private:
-  bool sortAscending = true; ///< Flag indicating whether the list control is sorted in ascending order.
+  /**
+   * @brief Formatted cells of one row.
+   */
+  struct CachedRow
+  {
+    long                  row        = -1; ///< Index of the row.
+    unsigned long         generation = 0;  ///< Predictions generation the cells were formatted at.
+    std::vector<wxString> cells;           ///< One formatted string per column.
+  };
+
+  bool                                                                      sortAscending = true; ///< Flag indicating whether the list control is sorted in ascending order.
+  std::vector<uint32_t>                                                     order;                ///< Table row shown at each index of the list.
+  std::vector<uint32_t>                                                     inverse;              ///< Index of the list showing each table row.
+  mutable std::list<CachedRow>                                              cache;                ///< Formatted rows, most recently used first.
+  mutable std::unordered_map<long, typename std::list<CachedRow>::iterator> cache_index;          ///< Position of each cached row in the cache.
+
+  /**
+   * @brief Gets the formatted cells of a row, formatting them on a cache miss.
+   *
+   * Rows are cached by table row, so sorting keeps the cache. Only the
+   * prediction cells are formatted again when the predictions changed since
+   * the row was cached.
+   *
+   * @param row The row of the table.
+   * @return The cached row, valid until the next call.
+   */
+  const CachedRow &cachedRow(long row) const;
 
   /**
    * @brief Gets the text to be displayed for a specific item and column.
@@ -109,6 +173,8 @@ template <typename T> class VirtualListControl : public wxListCtrl
   /**
    * @brief Sorts the list control by the specified column.
    *
+   * Only the permutation of the rows is sorted, the table is left untouched.
+   *
    * @param column The index of the column to sort by.
    */
   void sortByColumn(int column);
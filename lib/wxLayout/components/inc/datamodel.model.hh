@@ -10,15 +10,68 @@
  */
 #ifndef ITEMDATA_HH
 #define ITEMDATA_HH
+#include <atomic>
+#include <new>
 #include <string>
 #include <vector>
+#include <Eigen/Dense>
+#include <dataset.hh>
 
+/**
+ * @brief Columnar table of the samples shown by the list control.
+ *
+ * Inputs and outputs are Eigen::Map views of the dataset matrices, so the
+ * list and the trainer read the same buffers. Every block keeps one column
+ * per row of the list: a row index is a column offset, and the values of a
+ * sample are contiguous, which is the layout the network consumes.
+ */
 struct DataModel
 {
-  int                 id;
-  std::vector<double> inputs;
-  std::vector<double> outputs;
-  std::vector<double> predictions;
+  typedef Map<const MatrixXd> ConstBlock; /**< Read-only view of a dataset matrix. */
+
+  const CsvDataset          *dataset = nullptr;      /**< Dataset the views point into. */
+  ConstBlock                 inputs{nullptr, 0, 0};  /**< Inputs, one column per row. */
+  ConstBlock                 outputs{nullptr, 0, 0}; /**< Expected outputs, one column per row. */
+  MatrixXd                   predictions;            /**< Predictions, one column per row. */
+  std::vector<std::string>   column_names;           /**< Column names of the file. */
+  std::atomic<unsigned long> generation{0};          /**< Incremented whenever predictions change. */
+
+  /**
+   * @brief Point the table at a dataset.
+   *
+   * The dataset matrices are sized before loading starts, so the views stay
+   * valid while rows are still being parsed.
+   *
+   * @param source Dataset to show, it must outlive the table.
+   */
+  void bind(const CsvDataset &source)
+  {
+    dataset = &source;
+    // Map has no rebinding assignment, construct the views in place
+    new(&inputs) ConstBlock(source.getFeatures().data(), source.getFeatures().rows(), source.getFeatures().cols());
+    new(&outputs) ConstBlock(source.getTargets().data(), source.getTargets().rows(), source.getTargets().cols());
+    predictions.setZero(outputs.rows(), outputs.cols());
+    column_names = source.getColumnNames();
+    predictionsChanged();
+  }
+
+  /**
+   * @brief Signal that predictions were written, so cached cells are formatted again.
+   */
+  void predictionsChanged() { generation.fetch_add(1, std::memory_order_release); }
+
+  /**
+   * @brief Get the number of rows ready to be shown.
+   * @return Number of rows parsed so far.
+   */
+  int size() const { return dataset != nullptr ? dataset->rowsReady() : 0; }
+
+  /**
+   * @brief Get the id of a row.
+   * @param row Index of the row.
+   * @return Sample id.
+   */
+  int id(long row) const { return dataset->getIds()[row]; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -12,14 +12,36 @@
 #define _H_DATA_FRAME_H_
 #define _CRT_SECURE_NO_WARNINGS
 
+/**
+ * @brief Interval between two updates of the UI while training, about 30 Hz.
+ */
+#define PROGRESS_REFRESH_MS 33
+
+/**
+ * @brief Path and name prefix of the checkpoints written while training.
+ *
+ * Relative to the working directory. Checkpointing is off until one of the
+ * checkpoint sliders is moved above 0.
+ */
+#define CHECKPOINT_PREFIX "checkpoints/model"
+
 #include <wx/wx.h>
 #include <wx/spinctrl.h>
+#include <wx/choice.h>
+#include <wx/timer.h>
 #include <atomic>
 #include <thread>
 #include "datamodel.model.hh"
 #include "csvlist.control.hh"
+#include "progress.channel.hh"
 #include <Eigen/Dense>
 #include <NN.hh>
+#include <trainer.hh>
+#include <dataset.hh>
+#include <snapshot.hh>
+#include <checkpoint.hh>
+#include <validation.hh>
+#include <shuffle.hh>
 
 typedef VirtualListControl<DataModel> DataListControl;
 
@@ -60,17 +82,22 @@ class MainFrame : public wxFrame
   void Populate(int howManyItems);
 
   private:
-  AndresNeuralNetwork *NN;                /**< Pointer to the neural network object. */
-  double               Epochs;            /**< The number of training epochs. */
-  double               ExpectedAcc = 0.0; /**< The expected accuracy of the neural network. */
-  double               LearningRate;      /**< The learning rate of the neural network. */
-  double               Momentum;          /**< The momentum of the neural network. */
-  double               Threshold;         /**< The threshold value for the neural network. */
-  int                  batch_size = 32;   /**< The batch size for training. */
-  int                  n_f        = 7;    /**< The number of features. */
-  int                  n_o        = 1;    /**< The number of outputs. */
-
-  bool              processing;    /**< Flag indicating if processing is in progress. */
+  AndresNeuralNetwork *NN;                                      /**< Pointer to the neural network object. */
+  double               Epochs;                                  /**< The number of training epochs. */
+  double               ExpectedAcc       = 0.0;                 /**< Validation accuracy at which training stops, 0 to disable. */
+  double               LearningRate;                            /**< The learning rate of the neural network. */
+  double               Momentum;                                /**< The momentum of the neural network. */
+  double               Threshold;                               /**< The threshold value for the neural network. */
+  int                  batch_size        = 32;                  /**< The batch size for training. */
+  int                  threads           = 1;                   /**< The number of training threads. */
+  int                  n_f               = 7;                   /**< The number of features. */
+  int                  n_o               = 1;                   /**< The number of outputs. */
+  int                  checkpointEpochs  = 0;                   /**< Checkpoint every this many epochs, 0 to disable. */
+  int                  checkpointMinutes = 0;                   /**< Checkpoint every this many minutes, 0 to disable. */
+  int                  validationPercent = VALIDATION_PERCENT;  /**< Percentage of the rows held out for validation. */
+  int                  patience          = VALIDATION_PATIENCE; /**< Epochs without validation improvement before stopping. */
+
+  std::atomic<bool> processing;    /**< Flag indicating if processing is in progress. */
   std::atomic<bool> quitRequested; /**< Flag indicating if a quit request has been made. */
   std::atomic<bool> stopRequested; /**< Flag indicating if a stop request has been made. */
 
@@ -83,10 +110,16 @@ class MainFrame : public wxFrame
 
   wxLog *logger; /**< Pointer to the logger object. */
 
-  std::vector<VectorXd> input_data;  /**< The input data for training. */
-  std::vector<VectorXd> output_data; /**< The output data for training. */
+  CsvDataset                        dataset;       /**< The training data, streamed from the CSV file. */
+  wxTimer                           loadTimer;     /**< Grows the list while the dataset is loading. */
+  wxTimer                           progressTimer; /**< Drains the progress channel while training. */
+  ProgressChannel<TrainingProgress> progress;      /**< Progress published by the training thread. */
+  int                               loggedEpochs;  /**< Number of epochs already logged. */
+  WeightPublisher                   snapshots;     /**< Weights published by the training thread, read by save. */
 
-  ActivationFunction *activationFunction; /**< Pointer to the activation function object. */
+  ActivationType hiddenActivation; /**< The activation function of the hidden layers. */
+  ActivationType outputActivation; /**< The activation function of the output layer. */
+  OptimizerType  optimizerType;    /**< The optimizer of the neural network. */
 
   /**
    * @brief Event handler for the close event.
@@ -133,9 +166,35 @@ class MainFrame : public wxFrame
   /**
    * @brief Updates the neural network.
    */
-  void fill_data_vec(std::vector<VectorXd> &input_data, std::vector<VectorXd> &output_data, std::vector<DataModel> &items);
   void OnUpdateNN();
 
+  /**
+   * @brief Starts loading the dataset and shows its rows as they are parsed.
+   */
+  void LoadData();
+
+  /**
+   * @brief Event handler for the load timer, refreshes the row count of the list.
+   *
+   * @param event The timer event.
+   */
+  void OnLoadTimer(wxTimerEvent &event);
+
+  /**
+   * @brief Event handler for the progress timer.
+   *
+   * @param event The timer event.
+   */
+  void OnProgressTimer(wxTimerEvent &event);
+
+  /**
+   * @brief Shows the latest snapshot published by the training thread, if any.
+   *
+   * Updates the progress bar, takes over the predictions and repaints only
+   * the visible rows of the list.
+   */
+  void drainProgress();
+
   /**
    * @brief Appends a log message to the log text control.
    *
@@ -144,13 +203,26 @@ class MainFrame : public wxFrame
   void Log(const std::string &msg) { logTxt->AppendText(msg + "\n"); };
 
   /**
-   * @brief Trains the neural network with the given inputs and targets.
+   * @brief Trains the neural network on the dataset.
+   *
+   * The first epoch may start while the file is still loading: it waits for
+   * each batch to be parsed and trains on views of the dataset columns in
+   * file order. Once the file is loaded, every epoch visits the rows in a new
+   * random order, gathering each batch into a reused contiguous buffer.
+   * Progress is published to the progress channel, at most every
+   * PROGRESS_REFRESH_MS and at the end of each epoch; the thread never
+   * touches the UI or the list table. When enabled, checkpoints of the
+   * published weights are written in background every checkpointEpochs
+   * epochs or checkpointMinutes minutes, and once more when the run ends.
+   *
+   * The last validationPercent of the rows are held out. Each epoch is
+   * scored on them in background while the next one trains; training stops
+   * once ExpectedAcc is reached or after patience epochs without
+   * improvement, and the weights of the best epoch are restored.
    *
-   * @param inputs The input data for training.
-   * @param targets The target data for training.
    * @param batch_size The batch size for training.
    */
-  void train(const std::vector<VectorXd> &inputs, const std::vector<VectorXd> &targets, int batch_size);
+  void train(int batch_size);
 
   /**
    * @brief Creates and returns the parameter panel.
@@ -174,5 +246,8 @@ class MainFrame : public wxFrame
   wxSpinCtrl *HiddenLayer;       /**< Pointer to the hidden layer spin control. */
   wxSpinCtrl *HiddenLayerNumber; /**< Pointer to the hidden layer number spin control. */
   wxSpinCtrl *OutputLayer;       /**< Pointer to the output layer spin control. */
+  wxChoice   *HiddenActivation;  /**< Pointer to the hidden activation choice control. */
+  wxChoice   *OutputActivation;  /**< Pointer to the output activation choice control. */
+  wxChoice   *OptimizerChoice;   /**< Pointer to the optimizer choice control. */
 };
 #endif
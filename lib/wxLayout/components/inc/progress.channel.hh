@@ -0,0 +1,88 @@
+/**
+ * @file progress.channel.hh
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Defines the channel carrying training progress to the UI.
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef PROGRESS_CHANNEL_HH
+#define PROGRESS_CHANNEL_HH
+#include <atomic>
+#include <cstdint>
+#include <Eigen/Dense>
+#include <validation.hh>
+
+/**
+ * @brief Lock-free triple buffer between one writer and one reader.
+ *
+ * The writer fills its slot and publishes it, the reader picks up the latest
+ * published slot whenever it wants. Neither side ever waits: a slot published
+ * twice before the reader looks is simply replaced, so each snapshot has to
+ * carry the whole state rather than a delta. Slots are reused, so buffers
+ * inside them keep their allocation from one publish to the next.
+ *
+ * @tparam T The type of the snapshot.
+ */
+template <typename T> class ProgressChannel
+{
+  public:
+  /**
+   * @brief Gets the slot owned by the writer.
+   *
+   * @return The slot to fill before the next publish().
+   */
+  T &writeSlot() { return slots[write]; }
+
+  /**
+   * @brief Hands the writer slot to the reader and takes a free one.
+   */
+  void publish() { write = state.exchange(write | fresh, std::memory_order_acq_rel) & index; }
+
+  /**
+   * @brief Takes the latest published slot, if any.
+   *
+   * @return True if a new snapshot is available in readSlot().
+   */
+  bool consume()
+  {
+    if((state.load(std::memory_order_relaxed) & fresh) == 0) return false;
+    read = state.exchange(read, std::memory_order_acq_rel) & index;
+    return true;
+  }
+
+  /**
+   * @brief Gets the slot owned by the reader.
+   *
+   * @return The snapshot taken by the last successful consume().
+   */
+  T &readSlot() { return slots[read]; }
+
+  private:
+  static constexpr uint8_t index = 0x3; ///< Bits of the state holding the index of the shared slot.
+  static constexpr uint8_t fresh = 0x4; ///< Bit of the state set when the shared slot was published and not consumed.
+
+  T                    slots[3];   ///< Writer, shared and reader slots, in any order.
+  std::atomic<uint8_t> state{1};   ///< Index of the shared slot and the fresh bit.
+  uint8_t              write = 0;  ///< Index of the writer slot, only used by the writer.
+  uint8_t              read  = 2;  ///< Index of the reader slot, only used by the reader.
+};
+
+/**
+ * @brief Snapshot of a training run published by the worker thread.
+ */
+struct TrainingProgress
+{
+  int              epoch       = 0;   /**< Current epoch. */
+  int              batch       = 0;   /**< Batches done in the current epoch. */
+  int              batches     = 0;   /**< Expected number of batches per epoch. */
+  int              epochs_done = 0;   /**< Number of completed epochs. */
+  double           error       = 0.0; /**< Error of the last completed epoch. */
+  double           accuracy    = 0.0; /**< Accuracy of the last completed epoch. */
+  ValidationResult validation;        /**< Score of the last validated epoch, epoch 0 if none. */
+  Eigen::MatrixXd  predictions;       /**< Thresholded predictions, one column per row. */
+};
+
+#endif
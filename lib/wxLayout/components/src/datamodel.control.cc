@@ -6,6 +6,72 @@
 
 #include "csvlist.control.hh"
 #include "datamodel.model.hh"
+#include <cstdio>
+#include <iterator>
+#include <numeric>
+#if __has_include(<execution>)
+#include <execution>
+#endif
+
+/**
+ * @brief Format a value the way std::to_string does, without a temporary std::string.
+ * @param cell String receiving the text, its buffer is reused.
+ * @param value Value to format.
+ */
+static void formatCell(wxString &cell, double value)
+{
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%f", value);
+  cell = buffer;
+}
+
+/**
+ * @brief Template specialization for getting the formatted cells of a row.
+ * @tparam AppleData The type of data stored in the list control.
+ * @param row The row of the table.
+ * @return The cached row.
+ */
+template <> const VirtualListControl<DataModel>::CachedRow &VirtualListControl<DataModel>::cachedRow(long row) const
+{
+  unsigned long generation = table.generation.load(std::memory_order_acquire);
+  int           inputs     = table.inputs.rows();
+  int           outputs    = table.outputs.rows();
+  auto          found      = cache_index.find(row);
+
+  if(found != cache_index.end())
+    {
+      cache.splice(cache.begin(), cache, found->second);
+      CachedRow &cached = cache.front();
+      if(cached.generation != generation)
+        {
+          for(int i = 0; i < table.predictions.rows(); ++i) formatCell(cached.cells[1 + inputs + outputs + i], table.predictions(i, row));
+          cached.generation = generation;
+        }
+      return cached;
+    }
+
+  // recycle the least recently used row so its strings keep their buffers
+  if(cache.size() < LIST_CACHE_ROWS) { cache.emplace_front(); }
+  else
+    {
+      cache_index.erase(cache.back().row);
+      cache.splice(cache.begin(), cache, std::prev(cache.end()));
+    }
+
+  CachedRow &cached = cache.front();
+  cached.row        = row;
+  cached.generation = generation;
+  cached.cells.resize(1 + inputs + outputs + table.predictions.rows());
+
+  // the row index is the column offset in every block of the table
+  cached.cells[0] = wxString::Format("%d", table.id(row));
+  for(int i = 0; i < inputs; ++i) formatCell(cached.cells[1 + i], table.inputs(i, row));
+  for(int i = 0; i < outputs; ++i) formatCell(cached.cells[1 + inputs + i], table.outputs(i, row));
+  for(int i = 0; i < table.predictions.rows(); ++i) formatCell(cached.cells[1 + inputs + outputs + i], table.predictions(i, row));
+
+  cache_index[row] = cache.begin();
+  return cached;
+}
 
 /**
  * @brief Template specialization for getting the text of an item in the virtual list control.
@@ -16,18 +82,8 @@
  */
 template <> wxString VirtualListControl<DataModel>::OnGetItemText(long index, long column) const
 {
-  DataModel item = items[index];
-
-  int id_range_limit         = 1;
-  int input_range_limit      = item.inputs.size() + id_range_limit;
-  int output_range_limit     = item.outputs.size() + input_range_limit;
-  int prediction_range_limit = item.predictions.size() + output_range_limit;
-
-  if(column == 0) return std::to_string(item.id);
-  if(column < input_range_limit) return std::to_string(item.inputs[column - id_range_limit]);
-  if(column < output_range_limit) return std::to_string(item.outputs[column - input_range_limit]);
-  if(column < prediction_range_limit) return std::to_string(item.predictions[column - output_range_limit]);
-  return "";
+  const CachedRow &cached = cachedRow(rowAt(index));
+  return column < cached.cells.size() ? cached.cells[column] : wxString();
 }
 
 /**
@@ -49,48 +105,52 @@ template <> long VirtualListControl<DataModel>::GetFirstSelectedItem()
  */
 template <> void VirtualListControl<DataModel>::sortByColumn(int column)
 {
-  auto cmp = [](auto a, auto b, bool asc) { return asc ? a < b : a > b; };
-  bool asc = this->sortAscending;
-  std::sort(items.begin(), items.end(), [column, asc, cmp](auto a, auto b) {
-    switch(column)
-      {
-      default: return false;
-      }
-  });
+  long                rows    = table.size();
+  int                 inputs  = table.inputs.rows();
+  int                 outputs = table.outputs.rows();
+  std::vector<double> keys(rows);
+  Map<VectorXd>       key_view(keys.data(), rows);
+
+  // gather the column once, the comparisons then read a contiguous array
+  if(column == 0)
+    for(long row = 0; row < rows; ++row) keys[row] = table.id(row);
+  else if(column <= inputs) key_view = table.inputs.row(column - 1).head(rows).transpose();
+  else if(column <= inputs + outputs) key_view = table.outputs.row(column - 1 - inputs).head(rows).transpose();
+  else if(column <= inputs + 2 * outputs) key_view = table.predictions.row(column - 1 - inputs - outputs).head(rows).transpose();
+  else return;
+
+  order.resize(rows);
+  std::iota(order.begin(), order.end(), 0);
+
+  // ties keep file order so repeated clicks give the same permutation
+  bool ascending = sortAscending;
+  auto compare   = [&keys, ascending](uint32_t a, uint32_t b) {
+    if(keys[a] != keys[b]) return ascending ? keys[a] < keys[b] : keys[a] > keys[b];
+    return a < b;
+  };
+#if defined(__cpp_lib_execution) && __cpp_lib_execution >= 201603L
+  if(rows >= LIST_PARALLEL_SORT_ROWS) { std::sort(std::execution::par_unseq, order.begin(), order.end(), compare); }
+  else
+#endif
+    std::sort(order.begin(), order.end(), compare);
+
+  inverse.resize(rows);
+  for(long index = 0; index < rows; ++index) inverse[order[index]] = index;
 }
 
 /**
  * @brief Template specialization for resetting the data in the virtual list control.
  * @tparam AppleData The type of data stored in the list control.
+ * @param dataset The dataset holding the rows.
  */
-template <> void VirtualListControl<DataModel>::resetData()
+template <> void VirtualListControl<DataModel>::resetData(const CsvDataset &dataset)
 {
-  items.clear();
-  int rows = doc.GetRowCount();
-
-  // Iterate through each row in the CSV file
-  for(int i = 1; i < rows; ++i)
-    {
-      int current_col = 0;
-
-      DataModel item;
-
-      item.id = doc.GetCell<int>(current_col++, i);
-
-      int j = current_col;
-
-      for(j = current_col; j < current_col + num_of_inputs; j++) { item.inputs.push_back(doc.GetCell<double>(j, i)); }
-
-      current_col = j;
-
-      for(j = current_col; j < current_col + num_of_outputs; j++) { item.outputs.push_back(doc.GetCell<int>(j, i)); }
-
-      current_col = j;
-
-      for(j = current_col; j < current_col + num_of_outputs; j++) { item.predictions.push_back(0); }
-
-      items.push_back(item);
-    }
-
+  table.bind(dataset);
+  DeleteAllColumns();
+  for(const auto &header : table.column_names) { SetColumnWidth(AppendColumn(header), wxLIST_AUTOSIZE_USEHEADER); }
+  AppendColumn("Prediction");
+  order.clear();
+  inverse.clear();
+  invalidateCache();
   RefreshAfterUpdate();
 }
\ No newline at end of file
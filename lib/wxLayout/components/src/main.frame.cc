@@ -17,36 +17,14 @@
 #include "app.hh"
 #include "macros.hh"
 
-void MainFrame::fill_data_vec(std::vector<VectorXd> &input_data, std::vector<VectorXd> &output_data, std::vector<DataModel> &items)
+void MainFrame::OnUpdateNN()
 {
-  if(input_data.size() == 0 || output_data.size() == 0)
+  // the training thread owns the network until it ends
+  if(this->processing)
     {
-      int num_samples = items.size();
-
-      int num_features = n_f;
-      int num_outputs  = n_o;
-
-      for(int i = 0; i < num_samples; ++i)
-        {
-          VectorXd input_vector(num_features);
-          VectorXd output_vector(num_outputs);
-
-          for(int j = 0; j < num_features; ++j) { input_vector(j) = items[i].inputs[j]; }
-
-          for(int j = 0; j < num_outputs; ++j)
-            {
-              output_vector(j) = items[i].outputs[j];
-              items[i].predictions.push_back(0);
-            }
-
-          input_data.push_back(input_vector);
-          output_data.push_back(output_vector);
-        }
+      wxLogMessage("Stop training before changing the network");
+      return;
     }
-}
-
-void MainFrame::OnUpdateNN()
-{
   std::vector<int> topology;
   if(this->NN != nullptr)
     {
@@ -56,9 +34,14 @@ void MainFrame::OnUpdateNN()
   topology.push_back(this->InputLayerSize);
   for(int i = 0; i < this->HiddenLayerCount; i++) { topology.push_back(this->HiddenLayerSize); }
   topology.push_back(this->OutputLayerSize);
-  this->NN = new AndresNeuralNetwork(topology, this->LearningRate, this->Momentum, this->activationFunction);
+  std::vector<ActivationType> activations(topology.size() - 1, this->hiddenActivation);
+  activations.back() = this->outputActivation;
+  this->NN           = new AndresNeuralNetwork(topology, this->LearningRate, this->Momentum, activations);
+  this->NN->setOptimizer(this->optimizerType);
   wxLogMessage(wxString::Format(":: RESET NN ::"));
   for(auto element : topology) { wxLogMessage(wxString::Format("topology :: %d", element)); }
+  wxLogMessage(wxString::Format("activations :: %s / %s", activationName(this->hiddenActivation), activationName(this->outputActivation)));
+  wxLogMessage(wxString::Format("optimizer :: %s", optimizerName(this->optimizerType)));
 }
 
 struct gridctrl
@@ -81,7 +64,7 @@ wxPanel *MainFrame::ParamPanel()
   wxButton   *btn_train      = new wxButton(btn_panel, wxID_ANY, "train model", wxDefaultPosition, wxDefaultSize);
   wxButton   *btn_reset      = new wxButton(btn_panel, wxID_ANY, "reset weights", wxDefaultPosition, wxDefaultSize);
   wxButton   *btn_stop       = new wxButton(btn_panel, wxID_ANY, "stop current", wxDefaultPosition, wxDefaultSize);
-  wxButton   *btn_reset_data = new wxButton(btn_panel, wxID_ANY, "reset input_data", wxDefaultPosition, wxDefaultSize);
+  wxButton   *btn_reset_data = new wxButton(btn_panel, wxID_ANY, "reload data", wxDefaultPosition, wxDefaultSize);
   wxBoxSizer *btn_sizer      = new wxBoxSizer(wxHORIZONTAL);
   auto        Topology       = new wxPanel(panel, wxID_ANY);
   InputLayer                 = new wxSpinCtrl(Topology, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_NO_VSCROLL);
@@ -89,6 +72,10 @@ wxPanel *MainFrame::ParamPanel()
   HiddenLayerNumber          = new wxSpinCtrl(Topology, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_NO_VSCROLL);
   OutputLayer                = new wxSpinCtrl(Topology, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_NO_VSCROLL);
   auto TopologySizer         = new wxBoxSizer(wxHORIZONTAL);
+  auto Activations           = new wxPanel(panel, wxID_ANY);
+  HiddenActivation           = new wxChoice(Activations, wxID_ANY);
+  OutputActivation           = new wxChoice(Activations, wxID_ANY);
+  auto ActivationsSizer      = new wxBoxSizer(wxHORIZONTAL);
   InputLayer->SetRange(7, 7);
   InputLayer->SetValue(7);
   HiddenLayer->SetRange(7, 128);
@@ -114,6 +101,25 @@ wxPanel *MainFrame::ParamPanel()
     this->OutputLayerSize = event.GetInt();
     OnUpdateNN();
   });
+  // choice index is the ActivationType value, softmax is only offered on the output layer
+  for(auto type : {ActivationType::Sigmoid, ActivationType::ReLU, ActivationType::Tanh, ActivationType::LeakyReLU}) { HiddenActivation->Append(activationName(type)); }
+  for(auto type : {ActivationType::Sigmoid, ActivationType::ReLU, ActivationType::Tanh, ActivationType::LeakyReLU, ActivationType::Softmax}) { OutputActivation->Append(activationName(type)); }
+  HiddenActivation->SetSelection(static_cast<int>(this->hiddenActivation));
+  OutputActivation->SetSelection(static_cast<int>(this->outputActivation));
+  HiddenActivation->Bind(wxEVT_CHOICE, [this](wxCommandEvent &event) {
+    this->hiddenActivation = static_cast<ActivationType>(event.GetSelection());
+    OnUpdateNN();
+  });
+  OutputActivation->Bind(wxEVT_CHOICE, [this](wxCommandEvent &event) {
+    this->outputActivation = static_cast<ActivationType>(event.GetSelection());
+    if(this->outputActivation == ActivationType::Softmax && this->OutputLayerSize < 2) { wxLogMessage("Softmax needs at least two outputs"); }
+    OnUpdateNN();
+  });
+  ActivationsSizer->Add(new wxStaticText(Activations, wxID_ANY, "Hidden"), 0, wxALIGN_CENTER_VERTICAL | wxALL, littleMargin);
+  ActivationsSizer->Add(HiddenActivation, 1, wxEXPAND | wxALL, littleMargin);
+  ActivationsSizer->Add(new wxStaticText(Activations, wxID_ANY, "Output"), 0, wxALIGN_CENTER_VERTICAL | wxALL, littleMargin);
+  ActivationsSizer->Add(OutputActivation, 1, wxEXPAND | wxALL, littleMargin);
+  Activations->SetSizer(ActivationsSizer);
   TopologySizer->Add(InputLayer, 1, wxEXPAND | wxALL, littleMargin);
   TopologySizer->Add(HiddenLayer, 1, wxEXPAND | wxALL, littleMargin);
   TopologySizer->Add(HiddenLayerNumber, 1, wxEXPAND | wxALL, littleMargin);
@@ -127,11 +133,13 @@ wxPanel *MainFrame::ParamPanel()
     wxLogMessage("Stop requested");
   });
   btn_reset_data->Bind(wxEVT_BUTTON, [this](wxCommandEvent &event) {
-    this->input_data.clear();
-    this->output_data.clear();
-    dataList->items.clear();
-    dataList->resetData();
-    dataList->RefreshAfterUpdate();
+    // the training thread reads the dataset matrices
+    if(this->processing)
+      {
+        wxLogMessage("Stop training before reloading the data");
+        return;
+      }
+    LoadData();
   });
   btn_sizer->Add(btn_reset, 1, wxEXPAND | wxALL, margin);
   btn_sizer->Add(btn_train, 1, wxEXPAND | wxALL, margin);
@@ -141,11 +149,17 @@ wxPanel *MainFrame::ParamPanel()
     {{{rowSize++, 0}, {1, 1}}, btn_panel},
   };
   std::vector<std::pair<wxString, std::vector<int>>> Sliders = {
-    {"Learning rate", {25, 0, 100}  },
-    {"Momentum",      {15, 0, 100}  },
-    {"Epochs",        {0, 0, 1000}  },
-    {"Threshold",     {50, 0, 100}  },
-    {"Batch Size",    {32, 16, 1024}},
+    {"Learning rate",      {25, 0, 100}                                 },
+    {"Momentum",           {15, 0, 100}                                 },
+    {"Epochs",             {0, 0, 1000}                                 },
+    {"Threshold",          {50, 0, 100}                                 },
+    {"Batch Size",         {32, 16, 1024}                               },
+    {"Threads",            {this->threads, 1, 16}                       },
+    {"Checkpoint epochs",  {this->checkpointEpochs, 0, 100}             },
+    {"Checkpoint minutes", {this->checkpointMinutes, 0, 60}             },
+    {"Validation %",       {this->validationPercent, 0, 50}             },
+    {"Patience",           {this->patience, 0, 100}                     },
+    {"Target accuracy",    {static_cast<int>(this->ExpectedAcc), 0, 100}},
   };
   for(auto &slider : Sliders)
     {
@@ -186,11 +200,70 @@ wxPanel *MainFrame::ParamPanel()
           this->batch_size = event.GetPosition();
           wxLogMessage(wxString::Format("batch_size value :: %d", this->batch_size));
         });
+      else if(slider.first == "Threads")
+        wslider->Bind(wxEVT_SCROLL_CHANGED, [this](wxScrollEvent &event) {
+          this->threads = event.GetPosition();
+          wxLogMessage(wxString::Format("threads value :: %d", this->threads));
+        });
+      else if(slider.first == "Checkpoint epochs")
+        wslider->Bind(wxEVT_SCROLL_CHANGED, [this](wxScrollEvent &event) {
+          this->checkpointEpochs = event.GetPosition();
+          wxLogMessage(wxString::Format("checkpoint epochs value :: %d", this->checkpointEpochs));
+        });
+      else if(slider.first == "Checkpoint minutes")
+        wslider->Bind(wxEVT_SCROLL_CHANGED, [this](wxScrollEvent &event) {
+          this->checkpointMinutes = event.GetPosition();
+          wxLogMessage(wxString::Format("checkpoint minutes value :: %d", this->checkpointMinutes));
+        });
+      else if(slider.first == "Validation %")
+        wslider->Bind(wxEVT_SCROLL_CHANGED, [this](wxScrollEvent &event) {
+          this->validationPercent = event.GetPosition();
+          wxLogMessage(wxString::Format("validation value :: %d%%", this->validationPercent));
+        });
+      else if(slider.first == "Patience")
+        wslider->Bind(wxEVT_SCROLL_CHANGED, [this](wxScrollEvent &event) {
+          this->patience = event.GetPosition();
+          wxLogMessage(wxString::Format("patience value :: %d", this->patience));
+        });
+      else if(slider.first == "Target accuracy")
+        wslider->Bind(wxEVT_SCROLL_CHANGED, [this](wxScrollEvent &event) {
+          this->ExpectedAcc = event.GetPosition();
+          wxLogMessage(wxString::Format("target accuracy value :: %f", this->ExpectedAcc));
+        });
     }
+  auto optimizerLabel = new wxStaticText(panel, wxID_ANY, "Optimizer", wxDefaultPosition, wxDefaultSize);
+  OptimizerChoice     = new wxChoice(panel, wxID_ANY);
+  // choice index is the OptimizerType value
+  for(auto type : {OptimizerType::SGD, OptimizerType::Nesterov, OptimizerType::RMSProp, OptimizerType::Adam}) { OptimizerChoice->Append(optimizerName(type)); }
+  OptimizerChoice->SetSelection(static_cast<int>(this->optimizerType));
+  OptimizerChoice->Bind(wxEVT_CHOICE, [this](wxCommandEvent &event) {
+    // the training thread is stepping the current optimizer
+    if(this->processing)
+      {
+        OptimizerChoice->SetSelection(static_cast<int>(this->optimizerType));
+        wxLogMessage("Stop training before changing the optimizer");
+        return;
+      }
+    this->optimizerType = static_cast<OptimizerType>(event.GetSelection());
+    this->NN->setOptimizer(this->optimizerType);
+    wxLogMessage(wxString::Format("optimizer :: %s", optimizerName(this->optimizerType)));
+  });
+  paramPanelItems.push_back({
+    {{rowSize++, 0}, {1, 1}},
+    optimizerLabel
+  });
+  paramPanelItems.push_back({
+    {{rowSize++, 0}, {1, 1}},
+    OptimizerChoice
+  });
   paramPanelItems.push_back({
     {{rowSize++, 0}, {1, 1}},
     Topology
   });
+  paramPanelItems.push_back({
+    {{rowSize++, 0}, {1, 1}},
+    Activations
+  });
   paramPanelItems.push_back({
     {{rowSize++, 0}, {1, 1}},
     logTxt
@@ -212,7 +285,7 @@ wxPanel *MainFrame::DataPanel()
   wxPanel *panel                       = new wxPanel(this, wxID_ANY);
   auto     sizer                       = new wxGridBagSizer(margin, margin);
   progressBar                          = new wxGauge(panel, wxID_ANY, 100);
-  dataList                             = new DataListControl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, "apple_qlty.csv", n_f, n_o);
+  dataList                             = new DataListControl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, this->dataset, n_f, n_o);
   std::vector<gridctrl> dataPanelItems = {
     {{{rowSize++, 0}, {1, 1}}, progressBar},
     {{{rowSize++, 0}, {1, 1}}, dataList   },
@@ -224,7 +297,7 @@ wxPanel *MainFrame::DataPanel()
   return panel;
 }
 
-MainFrame::MainFrame(const wxString &title, const wxPoint &pos, const wxSize &size) : wxFrame(NULL, wxID_ANY, title, pos, size)
+MainFrame::MainFrame(const wxString &title, const wxPoint &pos, const wxSize &size) : wxFrame(NULL, wxID_ANY, title, pos, size), dataset(n_f, n_o)
 {
   this->HiddenLayerCount   = 1;
   this->HiddenLayerSize    = 16;
@@ -236,13 +309,22 @@ MainFrame::MainFrame(const wxString &title, const wxPoint &pos, const wxSize &si
   this->LearningRate       = 0.25;
   this->Momentum           = 0.15;
   this->batch_size         = 32;
-  this->activationFunction = new SigmoidActivation();
+  this->threads            = std::clamp<int>(std::thread::hardware_concurrency(), 1, 16);
+  this->hiddenActivation   = ActivationType::Sigmoid;
+  this->outputActivation   = ActivationType::Sigmoid;
+  this->optimizerType      = OptimizerType::SGD;
   this->NN                 = nullptr;
   this->n_f                = 7;
   this->n_o                = 1;
   auto mainSizer           = new wxBoxSizer(wxHORIZONTAL);
   mainSizer->Add(this->ParamPanel(), 1, wxEXPAND | wxALL, 0);
   mainSizer->Add(this->DataPanel(), 3, wxEXPAND | wxALL, 0);
+  this->loggedEpochs       = 0;
+  loadTimer.SetOwner(this);
+  Bind(wxEVT_TIMER, &MainFrame::OnLoadTimer, this, loadTimer.GetId());
+  progressTimer.SetOwner(this);
+  Bind(wxEVT_TIMER, &MainFrame::OnProgressTimer, this, progressTimer.GetId());
+  this->LoadData();
   this->SetSizerAndFit(mainSizer);
   this->SetMinSize(FromDIP(wxSize(800, 600)));
   this->OnUpdateNN();
@@ -260,32 +342,19 @@ MainFrame::MainFrame(const wxString &title, const wxPoint &pos, const wxSize &si
   this->stopRequested = false;
 }
 
-double compute_error(const std::vector<VectorXd> &predictions, const std::vector<VectorXd> &targets)
-{
-  double mse = 0.0;
-  for(int i = 0; i < predictions.size(); ++i)
-    {
-      auto pred_cols = predictions[i].cols();
-      auto pred_rows = predictions[i].rows();
-      auto targ_cols = targets[i].cols();
-      auto targ_rows = targets[i].rows();
-      auto diff      = predictions[i] - targets[i];
-      mse += diff.dot(diff);
-    }
-  return mse / predictions.size();
-}
+double compute_error(const Ref<const MatrixXd> &predictions, const Ref<const MatrixXd> &targets) { return (predictions - targets).squaredNorm() / predictions.cols(); }
 
-double compute_accuracy(const std::vector<VectorXd> &inputs, const std::vector<VectorXd> &targets, double threshold = 0.5)
+double compute_accuracy(const Ref<const MatrixXd> &predictions, const Ref<const MatrixXd> &targets, double threshold = 0.5)
 {
   int correct_predictions = 0;
-  for(int i = 0; i < inputs.size(); ++i)
+  for(int i = 0; i < predictions.cols(); ++i)
     {
-      if((inputs[i](0) >= threshold && targets[i](0) == 1) || (inputs[i](0) < threshold && targets[i](0) == 0)) { correct_predictions++; }
+      if((predictions(0, i) >= threshold && targets(0, i) == 1) || (predictions(0, i) < threshold && targets(0, i) == 0)) { correct_predictions++; }
     }
-  return static_cast<double>(correct_predictions) / inputs.size() * 100;
+  return static_cast<double>(correct_predictions) / predictions.cols() * 100;
 }
 
-void MainFrame::train(const std::vector<VectorXd> &inputs, const std::vector<VectorXd> &targets, int batch_size = 32)
+void MainFrame::train(int batch_size = 32)
 {
   this->processing = true;
   if(!NN)
@@ -294,35 +363,113 @@ void MainFrame::train(const std::vector<VectorXd> &inputs, const std::vector<Vec
       wxMessageBox("Neural network pointer is not valid.", "Error", wxICON_ERROR | wxOK);
       return;
     }
-  int                   num_samples = inputs.size();
-  bool                  epoch_mode  = this->Epochs > 0;
-  std::vector<VectorXd> Predictions(num_samples);
+  typedef std::chrono::steady_clock Clock;
+  bool                              epoch_mode    = this->Epochs > 0;
+  int                               train_rows    = dataset.getRows() - dataset.getRows() * this->validationPercent / 100;
+  bool                              validating    = train_rows > 0 && train_rows < dataset.getRows();
+  int                               restored      = 0;
+  const MatrixXd                   &features      = dataset.getFeatures();
+  const MatrixXd                   &labels        = dataset.getTargets();
+  MatrixXd                          Predictions   = MatrixXd::Zero(labels.rows(), labels.cols());
+  auto                              interval      = std::chrono::milliseconds(PROGRESS_REFRESH_MS);
+  auto                              last_publish  = Clock::now();
+  ParallelTrainer                   trainer(*NN, this->threads);
+  TrainingProgress                  state;
+  bool                              checkpointing = this->checkpointEpochs > 0 || this->checkpointMinutes > 0;
+  bool                              checkpointed  = false;
+  Checkpointer                      checkpointer(CHECKPOINT_PREFIX, CHECKPOINT_KEEP, this->checkpointEpochs, this->checkpointMinutes * 60.0);
+  Validator                         validator(this->threads, this->Threshold, this->patience, this->ExpectedAcc);
+  BatchShuffler                     shuffler;
+
+  // copies the whole state into the writer slot, a snapshot the UI skips loses nothing
+  auto publish = [&] {
+    TrainingProgress &slot = this->progress.writeSlot();
+    slot.epoch             = state.epoch;
+    slot.batch             = state.batch;
+    slot.batches           = state.batches;
+    slot.epochs_done       = state.epochs_done;
+    slot.error             = state.error;
+    slot.accuracy          = state.accuracy;
+    slot.validation        = state.validation;
+    slot.predictions       = (Predictions.array() > this->Threshold).cast<double>().matrix();
+    this->progress.publish();
+    this->snapshots.publish(*NN);
+    last_publish = Clock::now();
+  };
+
+  if(!validating) train_rows = dataset.getRows();
+  state.batches = (train_rows + batch_size - 1) / batch_size;
+  trainer.reserveBatch(batch_size);
   for(int epoch = 0; (epoch_mode && epoch < this->Epochs && !stopRequested) || (!epoch_mode && !stopRequested); ++epoch)
     {
       QUIT_ROUTINE();
-      for(int batch_start = 0; batch_start < num_samples; batch_start += batch_size)
+      int num_samples = 0;
+      // the first epoch streams in file order, later ones visit the loaded rows in a new order
+      bool shuffled   = dataset.isComplete();
+      state.epoch     = epoch;
+      state.batch     = 0;
+      if(shuffled) shuffler.shuffle(std::min(train_rows, dataset.rowsReady()));
+      for(int batch_start = 0;; batch_start += batch_size)
         {
-          int                   batch_end = std::min(batch_start + batch_size, num_samples);
-          std::vector<VectorXd> batchInputs(inputs.begin() + batch_start, inputs.begin() + batch_end);
-          std::vector<VectorXd> batchTargets(targets.begin() + batch_start, targets.begin() + batch_end);
-          std::vector<VectorXd> batchPredictions(batch_end - batch_start);
-          for(int sample_idx = 0; sample_idx < batchInputs.size(); ++sample_idx)
+          // returns at once after the first epoch, the file is loaded by then
+          int batch_end = std::min({batch_start + batch_size, train_rows, dataset.waitForRows(batch_start + batch_size)});
+          if(batch_end <= batch_start) break;
+          int batch_count = batch_end - batch_start;
+          if(shuffled)
             {
-              NN->forwardPropagation(batchInputs[sample_idx]);
-              auto prediction = NN->getResults();
-              NN->backpropagation(batchTargets[sample_idx]);
-              Predictions[batch_start + sample_idx] = prediction;
-              for(int i = 0; i < prediction.cols(); i++) this->dataList->items[batch_start + sample_idx].predictions[i] = prediction(i) > this->Threshold ? 1 : 0;
+              shuffler.gather(features, labels, batch_start, batch_count);
+              trainer.trainBatch(shuffler.getInputs(), shuffler.getTargets());
+              shuffler.scatter(trainer.getResults(), Predictions);
             }
+          else
+            {
+              trainer.trainBatch(features.middleCols(batch_start, batch_count), labels.middleCols(batch_start, batch_count));
+              Predictions.middleCols(batch_start, batch_count) = trainer.getResults();
+            }
+          num_samples = batch_end;
+          ++state.batch;
+          if(Clock::now() - last_publish >= interval) { publish(); }
         }
-      double error    = compute_error(Predictions, targets);
-      double accuracy = compute_accuracy(Predictions, targets, this->Threshold);
-      wxGetApp().CallAfter([this, epoch, error, accuracy] {
-        dataList->Refresh();
-        wxLogMessage("Epoch %d, Error: %.4f, Accuracy: %.4f", epoch, error, accuracy);
-      });
+      if(num_samples == 0) break;
+      state.batches     = state.batch;
+      state.error       = compute_error(Predictions.leftCols(num_samples), labels.leftCols(num_samples));
+      state.accuracy    = compute_accuracy(Predictions.leftCols(num_samples), labels.leftCols(num_samples), this->Threshold);
+      state.epochs_done = epoch + 1;
+      // the previous epoch was scored while this one trained, its outputs fill the held-out rows
+      bool stop = validating && validator.finish();
+      if(validator.getLast().epoch > 0)
+        {
+          state.validation                                                 = validator.getLast();
+          Predictions.middleCols(train_rows, validator.getOutputs().cols()) = validator.getOutputs();
+        }
+      publish();
+      // the snapshot was just published, the file is written off this thread
+      checkpointed = checkpointer.epochEnded(this->snapshots.latest(), state.epochs_done);
+      if(stop) break;
+      if(validating)
+        {
+          // the held-out rows are at the end of the file, usually parsed by the end of the first epoch
+          int rows = dataset.waitForRows(dataset.getRows());
+          if(rows > train_rows) validator.start(this->snapshots.latest(), features.middleCols(train_rows, rows - train_rows), labels.middleCols(train_rows, rows - train_rows), state.epochs_done);
+        }
+    }
+  if(validating) validator.finish();
+  if(validator.getBestSnapshot() != nullptr)
+    {
+      // the trainer is idle, the best weights replace the last ones
+      NN->copyParameters(*validator.getBestSnapshot());
+      this->snapshots.publish(*NN);
+      restored     = validator.getBest().epoch;
+      checkpointed = false;
     }
-  wxGetApp().CallAfter([this] {
+  if(checkpointing && state.epochs_done > 0 && !checkpointed) checkpointer.submit(this->snapshots.latest(), restored > 0 ? restored : state.epochs_done);
+  checkpointer.flush();
+  wxGetApp().CallAfter([this, checkpoint = checkpointer.getLastPath(), stopped = validator.shouldStop(), restored, best = validator.getBest()] {
+    this->progressTimer.Stop();
+    this->drainProgress();
+    if(stopped) wxLogMessage("Early stopping, validation stopped improving or reached %.2f%%", this->ExpectedAcc);
+    if(restored > 0) wxLogMessage("Restored epoch %d, Validation Error: %.4f, Validation Accuracy: %.4f", restored - 1, best.error, best.accuracy);
+    if(!checkpoint.empty()) wxLogMessage("Checkpoint saved to %s", checkpoint);
     progressBar->SetValue(0);
     this->stopRequested = false;
     this->processing    = false;
@@ -330,26 +477,81 @@ void MainFrame::train(const std::vector<VectorXd> &inputs, const std::vector<Vec
   });
 }
 
+void MainFrame::LoadData()
+{
+  // parsed in background, training waits for the rows it needs
+  if(!this->dataset.open(RES_DIR "/apple_qlty.csv")) { wxLogMessage("Error: Unable to load the training data."); }
+  dataList->resetData(this->dataset);
+  loadTimer.Start(100);
+}
+
+void MainFrame::OnLoadTimer(wxTimerEvent &event)
+{
+  dataList->RefreshAfterUpdate();
+  if(this->dataset.isComplete())
+    {
+      loadTimer.Stop();
+      wxLogMessage("Loaded %d samples", this->dataset.rowsReady());
+    }
+}
+
+void MainFrame::OnProgressTimer(wxTimerEvent &event) { drainProgress(); }
+
+void MainFrame::drainProgress()
+{
+  if(!this->progress.consume()) return;
+  TrainingProgress &snapshot = this->progress.readSlot();
+
+  progressBar->SetRange(std::max(snapshot.batches, 1));
+  progressBar->SetValue(std::min(snapshot.batch, std::max(snapshot.batches, 1)));
+
+  // the reader slot is ours until the next consume, swap instead of copying
+  auto &predictions = dataList->table.predictions;
+  if(snapshot.predictions.rows() == predictions.rows() && snapshot.predictions.cols() == predictions.cols())
+    {
+      predictions.swap(snapshot.predictions);
+      dataList->table.predictionsChanged();
+      dataList->RefreshVisible();
+    }
+
+  // at most one line per refresh, short epochs are summarised by the latest one
+  if(snapshot.epochs_done > this->loggedEpochs)
+    {
+      this->loggedEpochs = snapshot.epochs_done;
+      wxLogMessage("Epoch %d, Error: %.4f, Accuracy: %.4f", snapshot.epochs_done - 1, snapshot.error, snapshot.accuracy);
+      if(snapshot.validation.epoch > 0) wxLogMessage("Validation of epoch %d, Error: %.4f, Accuracy: %.4f", snapshot.validation.epoch - 1, snapshot.validation.error, snapshot.validation.accuracy);
+    }
+}
+
 void MainFrame::OnReset(wxCommandEvent &event)
 {
+  if(this->processing)
+    {
+      wxLogMessage("Stop training before resetting the weights");
+      return;
+    }
   progressBar->SetValue(0);
   OnUpdateNN();
 }
 
 void MainFrame::OnTrain(wxCommandEvent &event)
 {
-  fill_data_vec(this->input_data, this->output_data, dataList->items);
-  if(this->input_data.size() == 0 || this->output_data.size() == 0)
+  if(this->dataset.getRows() == 0)
     {
-      wxMessageBox("No input_data to train the model.", "Error", wxICON_ERROR | wxOK);
+      wxMessageBox("No data to train the model.", "Error", wxICON_ERROR | wxOK);
       return;
     }
   if(!this->processing)
     {
+      // set before the thread starts so the UI refuses changes to the network at once
+      this->processing   = true;
+      this->loggedEpochs = 0;
+      this->snapshots.publish(*NN);
+      this->progressTimer.Start(PROGRESS_REFRESH_MS);
       const auto f = [this] {
         wxLogMessage("Training started :: Thread ");
         wxGetApp().CallAfter([this] { this->Layout(); });
-        this->train(this->input_data, this->output_data, this->batch_size);
+        this->train(this->batch_size);
         wxLogMessage("Training ended :: Thread ");
       };
       this->workerThread = std::thread(f);
@@ -360,6 +562,11 @@ void MainFrame::OnTrain(wxCommandEvent &event)
 
 void MainFrame::OnOpen(wxCommandEvent &event)
 {
+  if(this->processing)
+    {
+      wxLogMessage("Stop training before opening a model");
+      return;
+    }
   wxFileDialog openFileDialog(this, "Open File", "", "", "All files (*.*)|*.*", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
   if(openFileDialog.ShowModal() == wxID_CANCEL) return;
   wxString filePath = openFileDialog.GetPath();
@@ -373,6 +580,12 @@ void MainFrame::OnOpen(wxCommandEvent &event)
   HiddenLayer->SetValue(t.at(1));
   HiddenLayerNumber->SetValue(t.size() - 2);
   OutputLayer->SetValue(this->NN->getTopology()[t.size() - 1]);
+
+  auto activations       = NN->getActivations();
+  if(activations.size() > 1) { this->hiddenActivation = activations.front(); }
+  this->outputActivation = activations.back();
+  HiddenActivation->SetSelection(static_cast<int>(this->hiddenActivation));
+  OutputActivation->SetSelection(static_cast<int>(this->outputActivation));
 }
 
 void MainFrame::OnSave(wxCommandEvent &event)
@@ -380,8 +593,11 @@ void MainFrame::OnSave(wxCommandEvent &event)
   wxFileDialog saveFileDialog(this, "Save File", "", "", "All files (*.*)|*.*", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
   if(saveFileDialog.ShowModal() == wxID_CANCEL) return;
   wxString filePath = saveFileDialog.GetPath();
-  this->NN->saveWeights(filePath.ToStdString());
-  wxLogMessage("File saved to: %s", filePath);
+  // while training, save the latest published weights instead of racing with the trainer
+  auto snapshot = this->processing ? this->snapshots.latest() : nullptr;
+  bool saved    = snapshot != nullptr ? snapshot->saveWeights(filePath.ToStdString()) : this->NN->saveWeights(filePath.ToStdString());
+  if(saved) { wxLogMessage("File saved to: %s", filePath); }
+  else { wxLogMessage("Error: Unable to save file."); }
 }
 
 void MainFrame::OnClose(wxCommandEvent &e)
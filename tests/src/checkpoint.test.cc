@@ -0,0 +1,90 @@
+/**
+ * @file checkpoint.test.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Checks which checkpoint files the checkpointer keeps, including an epoch written twice
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <checkpoint.hh>
+
+/**
+ * @brief Number of checkpoints kept by the test.
+ */
+#define TEST_KEEP 3
+
+/**
+ * @brief Count the checkpoint files left in a directory.
+ * @param directory Directory of the checkpoints.
+ * @return Number of .model files.
+ */
+static int countFiles(const std::filesystem::path &directory)
+{
+  int count = 0;
+  for(const auto &entry : std::filesystem::directory_iterator(directory))
+    if(entry.path().extension() == ".model") ++count;
+  return count;
+}
+
+/**
+ * @brief Write checkpoints for a list of epochs, waiting for each one.
+ * @param prefix Path and name prefix of the files.
+ * @param epochs Epochs to write, in order.
+ * @param last Receives the path the checkpointer reports as its last.
+ */
+static void writeEpochs(const std::string &prefix, std::initializer_list<int> epochs, std::string &last)
+{
+  Checkpointer           checkpointer(prefix, TEST_KEEP);
+  Checkpointer::Snapshot snapshot = std::make_shared<const AndresNeuralNetwork>(std::vector<int>{4, 8, 1}, 0.1, 0.0);
+  for(int epoch : epochs)
+    {
+      checkpointer.submit(snapshot, epoch);
+      checkpointer.flush();
+    }
+  last = checkpointer.getLastPath();
+}
+
+/**
+ * @brief Check the files left by one sequence of epochs.
+ * @param name Name of the case, for the report.
+ * @param epochs Epochs to write, in order.
+ * @param expected_last Epoch the last checkpoint must belong to.
+ * @param expected_count Number of files that must be left.
+ * @return True if the case passed.
+ */
+static bool check(const char *name, std::initializer_list<int> epochs, int expected_last, int expected_count)
+{
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "nn_checkpoint_test";
+  std::filesystem::remove_all(directory);
+
+  std::string last;
+  writeEpochs((directory / "model").string(), epochs, last);
+
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "model-%06d.model", expected_last);
+  bool ok = last == (directory / suffix).string() && std::filesystem::exists(last) && countFiles(directory) == expected_count;
+  if(!ok) { std::cerr << name << ": last checkpoint " << last << (std::filesystem::exists(last) ? "" : " (missing)") << ", " << countFiles(directory) << " files left" << std::endl; }
+
+  std::filesystem::remove_all(directory);
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  ok &= check("rotation", {1, 2, 3, 4, 5}, 5, TEST_KEEP);
+  ok &= check("same epoch twice", {1, 2, 3, 3}, 3, TEST_KEEP);
+  // the best epoch written again after early stopping restored it
+  ok &= check("restored epoch", {1, 2, 3, 1}, 1, TEST_KEEP);
+  ok &= check("restored epoch after rotation", {2, 3, 4, 5, 6, 4}, 4, TEST_KEEP);
+  if(!ok) return 1;
+
+  std::cout << "Checkpoints kept as expected" << std::endl;
+  return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file lstm_gradient.test.cc
+ * @author andres coronado (invizuz@gmail.com)
+ * @brief Checks the Loss and LSTM gradients against central differences
+ * @version 0.1
+ * @date 2024-03-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include <lstm.hh>
+
+using namespace Eigen;
+
+/**
+ * @brief Step of the central differences.
+ */
+#define TEST_EPSILON 1e-6
+
+/**
+ * @brief Largest accepted difference, relative to the gradient when it is above 1.
+ */
+#define TEST_TOLERANCE 1e-6
+
+/**
+ * @brief Timesteps of every sequence of the LSTM check.
+ */
+#define TEST_STEPS 7
+
+/**
+ * @brief Targets suited to a loss: probabilities, one-hot columns, signs or real values.
+ * @param type Loss function.
+ * @param rows Number of outputs.
+ * @param cols Number of samples.
+ * @return Target matrix.
+ */
+static MatrixXd make_targets(LossType type, int rows, int cols)
+{
+  MatrixXd random = MatrixXd::Random(rows, cols);
+  switch(type)
+    {
+    case LossType::BinaryCrossEntropy: return (random.array() + 1.0) / 2.0;
+    case LossType::CategoricalCrossEntropy:
+      {
+        MatrixXd targets = MatrixXd::Zero(rows, cols);
+        for(int j = 0; j < cols; ++j) targets(j % rows, j) = 1.0;
+        return targets;
+      }
+    case LossType::Hinge: return (random.array() > 0.0).select(MatrixXd::Ones(rows, cols), -MatrixXd::Ones(rows, cols));
+    // both sides of the Huber threshold
+    case LossType::Huber: return 2.0 * random;
+    default: return random;
+    }
+}
+
+/**
+ * @brief Compare Loss::gradient() with central differences of Loss::value().
+ * @param loss Loss function.
+ * @return Largest difference.
+ */
+static double check_loss(const Loss &loss)
+{
+  MatrixXd outputs = 3.0 * MatrixXd::Random(4, 6);
+  MatrixXd targets = make_targets(loss.get_type(), 4, 6);
+  MatrixXd gradient;
+  loss.gradient(outputs, targets, gradient);
+
+  double error = 0.0;
+  for(Index i = 0; i < outputs.size(); ++i)
+    {
+      MatrixXd plus = outputs, minus = outputs;
+      plus(i) += TEST_EPSILON;
+      minus(i) -= TEST_EPSILON;
+      // value() is the mean over the columns, gradient() the per-sample gradient
+      double numeric = (loss.value(plus, targets) - loss.value(minus, targets)) / (2.0 * TEST_EPSILON) * outputs.cols();
+      error          = std::max(error, std::abs(numeric - gradient(i)) / std::max(1.0, std::abs(gradient(i))));
+    }
+  return error;
+}
+
+/**
+ * @brief Compare LSTM::backward() with central differences of the loss, parameter by parameter.
+ *
+ * The weights are private, so each parameter is moved through update() with
+ * a gradient that is 1 on that parameter and 0 everywhere else.
+ *
+ * @param loss Loss function.
+ * @param batch Number of sequences.
+ * @param checkpoint Timesteps per checkpoint segment, 0 to keep the whole tape.
+ * @return Largest difference.
+ */
+static double check_lstm(const Loss &loss, int batch, int checkpoint)
+{
+  LSTM network({3, 5, 4, 2});
+  network.set_loss(loss);
+  network.set_checkpoint_every(checkpoint);
+  MatrixXd inputs  = MatrixXd::Random(3, TEST_STEPS * batch);
+  MatrixXd targets = make_targets(loss.get_type(), 2, TEST_STEPS * batch);
+
+  network.reset_state(batch);
+  network.forward(inputs, batch);
+  network.backward(inputs, targets);
+  std::vector<MatrixXd> dW = network.dW, db = network.db;
+  MatrixXd              dV = network.dV, dc = network.dc;
+
+  auto value = [&]() {
+    network.reset_state(batch);
+    network.forward(inputs, batch);
+    return loss.value(network.get_output(), targets);
+  };
+
+  // every gradient of the network and its analytic value, probed one coefficient at a time
+  std::vector<std::pair<MatrixXd *, const MatrixXd *>> parameters;
+  for(size_t i = 0; i < dW.size(); ++i)
+    {
+      parameters.push_back({&network.dW[i], &dW[i]});
+      parameters.push_back({&network.db[i], &db[i]});
+    }
+  parameters.push_back({&network.dV, &dV});
+  parameters.push_back({&network.dc, &dc});
+
+  double error = 0.0;
+  for(auto &parameter : parameters)
+    for(Index i = 0; i < parameter.second->size(); ++i)
+      {
+        for(auto &other : parameters) other.first->setZero();
+        (*parameter.first)(i) = 1.0;
+
+        network.update(-TEST_EPSILON);
+        double plus = value();
+        network.update(2.0 * TEST_EPSILON);
+        double minus = value();
+        network.update(-TEST_EPSILON);
+
+        double analytic = (*parameter.second)(i);
+        double numeric  = (plus - minus) / (2.0 * TEST_EPSILON);
+        error           = std::max(error, std::abs(numeric - analytic) / std::max(1.0, std::abs(analytic)));
+      }
+  return error;
+}
+
+int main()
+{
+  const std::vector<LossType> losses = {LossType::MSE, LossType::BinaryCrossEntropy, LossType::CategoricalCrossEntropy, LossType::Hinge, LossType::Huber};
+  bool                        ok     = true;
+  std::srand(1);
+
+  for(LossType type : losses)
+    {
+      Loss   loss(type);
+      double error = check_loss(loss);
+      if(error > TEST_TOLERANCE)
+        {
+          std::cerr << loss.get_name() << ": loss gradient off by " << error << std::endl;
+          ok = false;
+        }
+
+      for(int batch : {1, 3})
+        for(int checkpoint : {0, 1, 3, 5})
+          {
+            error = check_lstm(loss, batch, checkpoint);
+            if(error > TEST_TOLERANCE)
+              {
+                std::cerr << loss.get_name() << ", batch " << batch << ", checkpoint " << checkpoint << ": LSTM gradient off by " << error << std::endl;
+                ok = false;
+              }
+          }
+    }
+  if(!ok) return 1;
+
+  std::cout << "Loss and LSTM gradients match the central differences" << std::endl;
+  return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file no_malloc.test.cc
+ * @author Andres Coronado (andres.coronado@bss.group)
+ * @brief Checks that steady-state training and inference of eig_neuron do not touch the heap
+ * @version 0.1
+ * @date 2024-03-07
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <NN.hh>
+#include <trainer.hh>
+
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+#error "no_malloc.test.cc must be built with EIGEN_RUNTIME_NO_MALLOC"
+#endif
+
+/**
+ * @brief Samples per batch of the test.
+ */
+#define TEST_BATCH 64
+
+/**
+ * @brief Batches run before the heap is forbidden, so that optimizer state and thread-local workspaces exist.
+ */
+#define TEST_WARMUP 2
+
+/**
+ * @brief Batches run while the heap is forbidden.
+ */
+#define TEST_STEPS 4
+
+/**
+ * @brief Train and score one network with Eigen heap allocations forbidden after a warm-up.
+ *
+ * Any Eigen allocation in the hot path fails the eigen_assert behind
+ * EIGEN_RUNTIME_NO_MALLOC and aborts the test.
+ *
+ * @tparam Scalar Scalar type of the network.
+ * @param activations Activation function of each layer.
+ * @param optimizer Optimizer of the network.
+ * @param threads Threads of the parallel trainer.
+ */
+template <typename Scalar> static void run(const std::vector<ActivationType> &activations, OptimizerType optimizer, int threads)
+{
+  typedef typename BasicNeuralNetwork<Scalar>::Matrix Matrix;
+  const std::vector<int>                              topology = {16, 32, 32, 4};
+  BasicNeuralNetwork<Scalar>                          network(topology, 0.01, 0.9, activations);
+  network.setOptimizer(optimizer);
+  BasicParallelTrainer<Scalar> trainer(network, threads);
+
+  typename BasicNeuralNetwork<Scalar>::Workspace ws;
+  Matrix                                         inputs  = Matrix::Random(topology.front(), TEST_BATCH);
+  Matrix                                         targets = (Matrix::Random(topology.back(), TEST_BATCH).array() + 1) / 2;
+  Matrix                                         outputs(topology.back(), TEST_BATCH);
+  network.reserveBatch(TEST_BATCH);
+  trainer.reserveBatch(TEST_BATCH);
+
+  for(int step = 0; step < TEST_WARMUP + TEST_STEPS; ++step)
+    {
+      Eigen::internal::set_is_malloc_allowed(step < TEST_WARMUP);
+      network.forwardPropagation(inputs);
+      network.backpropagation(targets);
+      trainer.trainBatch(inputs, targets);
+      network.predict(inputs, ws);
+      network.predict(inputs);
+      network.predict(inputs, outputs);
+    }
+  Eigen::internal::set_is_malloc_allowed(true);
+}
+
+int main()
+{
+  const std::vector<std::vector<ActivationType>> activations = {
+    {ActivationType::Sigmoid, ActivationType::Sigmoid, ActivationType::Sigmoid},
+    {ActivationType::ReLU, ActivationType::Tanh, ActivationType::Softmax},
+    {ActivationType::LeakyReLU, ActivationType::ReLU, ActivationType::Sigmoid},
+  };
+  const std::vector<OptimizerType> optimizers = {OptimizerType::SGD, OptimizerType::Nesterov, OptimizerType::RMSProp, OptimizerType::Adam};
+
+  for(const auto &layers : activations)
+    for(auto optimizer : optimizers)
+      for(int threads : {1, 4})
+        {
+          run<double>(layers, optimizer, threads);
+          run<float>(layers, optimizer, threads);
+        }
+
+  std::cout << "No heap allocation in steady-state training and inference" << std::endl;
+  return 0;
+}